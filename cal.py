@@ -1,18 +1,31 @@
 # pip install msal requests bleak
-import msal, requests, json, os, argparse, asyncio, sys
+import msal, requests, json, os, argparse, asyncio, sys, zlib, struct, time, subprocess, tempfile
 from datetime import datetime, timedelta, timezone
 from zoneinfo import ZoneInfo
-from typing import List, Dict, Any, Optional
+from typing import List, Dict, Any, Optional, Callable, Tuple
 
 try:
     from bleak import BleakScanner, BleakClient
+    from bleak.exc import BleakError
 except ImportError:  # graceful fallback
     BleakScanner = None
     BleakClient = None
+    BleakError = Exception
 
 BLE_SERVICE_UUID = "7e20c560-55dd-4c7a-9c61-8f6ea7d7c301"
 BLE_CHARACTERISTIC_UUID = "9c5a5dd9-3c40-4e58-9d0a-95bf7cb9d302"
+BLE_NOTIFY_UUID = "9c5a5dd9-3c40-4e58-9d0a-95bf7cb9d303"  # ACK:/DONE:/ERR: vom Gerät
+BLE_STATUS_UUID = "9c5a5dd9-3c40-4e58-9d0a-95bf7cb9d304"  # lesbarer Gerätestand (Hashes, Fähigkeiten)
+BLE_ACK_TIMEOUT = 5.0
+BLE_ATTEMPTS = 4          # Verbindungsversuche pro Upload (gerahmte Transfers werden fortgesetzt)
+BLE_RETRY_DELAY = 2.0
+FRAME_OVERHEAD = 8        # Offset + CRC32 pro gerahmtem Chunk
 DEFAULT_DAYS = 7
+FRAME_BYTES = 792 // 4 * 272  # LENP: natives Panel-Bild, 2 Bit/Pixel
+CALRENDER = os.path.join(os.path.dirname(os.path.abspath(__file__)), "tools", "render", "calrender")
+# Felder, die die Firmware auswertet; alles andere wird vor dem Senden entfernt
+DEVICE_FIELDS = ("id", "start", "end", "subject", "summary", "location", "organizer", "importance",
+                 "hasAttachments", "isOnlineMeeting", "isRecurring", "isMoved", "isCancelled")
 
 # ---------------- O365 Auth & Fetch -----------------
 
@@ -97,7 +110,10 @@ def condense_events(events: List[Dict[str, Any]]) -> List[Dict[str, Any]]:
             isRecurring = True
             if evt.get("seriesMasterId") and (evt.get("type") == "exception" or evt.get("originalStart")):
                 isMoved = True
+        graph_id = evt.get("id") or ""
         out.append({
+            # Stabile Kurz-ID für Delta-Uploads (CRC32 der Graph-ID)
+            "id": f"{zlib.crc32(graph_id.encode('utf-8')):08x}" if graph_id else None,
             "date": date_local,
             "start": start_local,
             "end": end_local,
@@ -120,97 +136,581 @@ def condense_events(events: List[Dict[str, Any]]) -> List[Dict[str, Any]]:
         })
     return out
 
+# ---------------- Payload -----------------
+
+# Binärformat (siehe lib/CalBin/CalBin.h): Header, 20-Byte Records, String-Tabelle
+CALBIN_MAGIC = b"ECAL"
+CALBIN_VERSION = 2
+CALBIN_RECORD = struct.Struct("<IIHhBBHHH")
+CALBIN_OP_UPSERT = 0
+CALBIN_OP_DELETE = 1
+CALBIN_FLAG_BITS = (
+    ("isOnlineMeeting", 1 << 1),
+    ("isRecurring", 1 << 2),
+    ("isMoved", 1 << 3),
+    ("hasAttachments", 1 << 4),
+    ("isCancelled", 1 << 5),
+)
+CALBIN_IMPORTANT = 1 << 0
+CALBIN_HAS_TITLE = 1 << 6
+CALBIN_HAS_END = 1 << 7
+# Feldgrößen der Firmware inkl. Terminator (CalStream.h); Strings werden identisch gekürzt,
+# damit Hashes auf beiden Seiten übereinstimmen
+FIELD_CAPS = {"title": 96, "location": 64, "organizer": 48}
+FNV_OFFSET = 2166136261
+FNV_PRIME = 16777619
+
+def parse_iso(s: str) -> datetime:
+    return datetime.strptime(s, "%Y-%m-%dT%H:%M:%S%z")
+
+def format_iso(dt: datetime) -> str:
+    return dt.strftime("%Y-%m-%dT%H:%M:%S%z")
+
+def clip_utf8(value: Any, cap: int) -> str:
+    if not isinstance(value, str):
+        return ""
+    b = value.encode("utf-8")
+    return value if len(b) < cap else b[:cap - 1].decode("utf-8", "ignore")
+
+def fnv1a(data: bytes, h: int = FNV_OFFSET) -> int:
+    for c in data:
+        h = ((h ^ c) * FNV_PRIME) & 0xFFFFFFFF
+    return h
+
+def event_hash(n: Dict[str, Any]) -> int:
+    """Wie calBinEventHash(): start, end, title, organizer, location (je NUL) + Flag-Byte."""
+    data = b"".join(n[k].encode("utf-8") + b"\0" for k in ("start", "end", "title", "organizer", "location"))
+    return fnv1a(data + bytes([n["flags"]]))
+
+def set_hash(events: List[Dict[str, Any]]) -> int:
+    """Wie CalBinSetHash: reihenfolgeunabhängig über (id, hash)."""
+    total = 0
+    for n in events:
+        total = (total + fnv1a(struct.pack("<II", n["id"], n["hash"]))) & 0xFFFFFFFF
+    return total ^ ((len(events) * 0x9E3779B1) & 0xFFFFFFFF)
+
+def normalize_event(e: Dict[str, Any]) -> Optional[Dict[str, Any]]:
+    """Event so, wie die Firmware es nach dem Dekodieren sieht (Basis für Encoding und Hash)."""
+    if not e.get("start"):
+        return None
+    start = parse_iso(e["start"])
+    flags = 0
+    duration = 0
+    end = ""
+    if e.get("end"):
+        duration = int((parse_iso(e["end"]) - start).total_seconds() // 60)
+        duration = max(0, min(duration, 0xFFFF))
+        end = format_iso(start + timedelta(minutes=duration))
+        flags |= CALBIN_HAS_END
+    title = e.get("summary") if isinstance(e.get("summary"), str) else e.get("subject")
+    if isinstance(title, str):
+        flags |= CALBIN_HAS_TITLE
+    if e.get("importance") == "high":
+        flags |= CALBIN_IMPORTANT
+    for key, bit in CALBIN_FLAG_BITS:
+        if e.get(key):
+            flags |= bit
+    n = {
+        "start_epoch": int(start.timestamp()),
+        "offset": int(start.utcoffset().total_seconds() // 60),
+        "duration": duration,
+        "start": format_iso(start),
+        "end": end,
+        "title": clip_utf8(title, FIELD_CAPS["title"]),
+        "organizer": clip_utf8(e.get("organizer"), FIELD_CAPS["organizer"]),
+        "location": clip_utf8(e.get("location"), FIELD_CAPS["location"]),
+        "flags": flags,
+    }
+    n["hash"] = event_hash(n)
+    # Ohne id (ältere Dateien) dient der Inhalts-Hash als Identität – wie calBinEventId()
+    n["id"] = int(e["id"], 16) if isinstance(e.get("id"), str) else n["hash"]
+    return n
+
+def load_normalized(json_path: str) -> List[Dict[str, Any]]:
+    with open(json_path, "r", encoding="utf-8") as f:
+        events = json.load(f)
+    return [n for n in (normalize_event(e) for e in events) if n]
+
+def payload_order(events: List[Dict[str, Any]], fmt: str) -> List[Dict[str, Any]]:
+    """Reihenfolge der Events im Payload: JSON wie in der Datei, CalBin nach (Start-Epoch, ID) –
+    so sortiert auch die Firmware nach dem Mergen eines Deltas (unabhängig vom Offset im String)."""
+    return sorted(events, key=lambda n: (n["start_epoch"], n["id"])) if fmt == "bin" else events
+
+def device_events_hash(events: List[Dict[str, Any]], today: str) -> int:
+    """Wie CalEventDay::hash() der Firmware über die Events von `today` (inkl. Anzeige-Aufbereitung)."""
+    h = FNV_OFFSET
+    for n in events:
+        if n["start"][:10] != today:
+            continue
+        title = n["title"].encode("utf-8") if n["flags"] & CALBIN_HAS_TITLE else "(kein Titel)".encode("utf-8")
+        loc = n["location"].encode("utf-8")
+        if loc.startswith(b"; "):
+            # Arduino String::substring(2, len-2) vertauscht die Grenzen, falls nötig
+            left, right = sorted((2, len(loc) - 2))
+            loc = loc[left:right]
+        for prefix in (b"DE-", b"HB-", b"COC-"):
+            loc = loc.replace(prefix, b"")
+        flags = n["flags"]
+        # wie CalTime::minutes und calEventEndMin(): lokale Minuten, Ende auf den Starttag begrenzt
+        start_min = (n["start_epoch"] + n["offset"] * 60) % 86400 // 60
+        end_min = min(start_min + n["duration"], 24 * 60) if flags & CALBIN_HAS_END else 0
+        head = struct.pack("<HHB", start_min, end_min, flags)
+        h = fnv1a(head + title + b"\0" + n["organizer"].encode("utf-8") + b"\0" + loc + b"\0", h)
+    return h
+
+def encode_calendar_bin(events: List[Dict[str, Any]], deletes: List[int] = ()) -> bytes:
+    """Normalisierte Events (+ zu löschende IDs bei Deltas) -> CalBin v2 (Strings dedupliziert)."""
+    table = bytearray(b"\0")
+    offsets: Dict[str, int] = {"": 0}
+
+    def intern(value: str) -> int:
+        if value not in offsets:
+            offsets[value] = len(table)
+            table.extend(value.encode("utf-8") + b"\0")
+        return offsets[value]
+
+    records = bytearray()
+    for n in events:
+        records += CALBIN_RECORD.pack(n["id"], n["start_epoch"], n["duration"], n["offset"], n["flags"],
+                                      CALBIN_OP_UPSERT, intern(n["title"]), intern(n["organizer"]),
+                                      intern(n["location"]))
+    for event_id in deletes:
+        records += CALBIN_RECORD.pack(event_id, 0, 0, 0, 0, CALBIN_OP_DELETE, 0, 0, 0)
+    count = len(events) + len(deletes)
+    if len(table) > 0xFFFF or count > 0xFFFF:
+        raise ValueError("Kalender zu groß für CalBin")
+    header = struct.pack("<4sBBHI", CALBIN_MAGIC, CALBIN_VERSION, 0, count, len(table))
+    return header + bytes(records) + bytes(table)
+
+def build_payload(json_path: str, fmt: str = "bin") -> bytes:
+    """Payload wie sie übertragen wird: CalBin oder kompaktes JSON (nur Geräte-Felder)."""
+    if fmt == "bin":
+        return encode_calendar_bin(payload_order(load_normalized(json_path), fmt))
+    with open(json_path, "r", encoding="utf-8") as f:
+        events = json.load(f)
+    slim = [{k: e[k] for k in DEVICE_FIELDS if k in e} for e in events]
+    return json.dumps(slim, ensure_ascii=False, separators=(",", ":")).encode("utf-8")
+
+def compress_payload(raw: bytes) -> bytes:
+    # zlib-Format (Header + Adler-32), passend zu tinfl auf dem Gerät
+    return zlib.compress(raw, 9)
+
+# ---------------- Delta Sync -----------------
+# Stand des letzten erfolgreich übertragenen Uploads: {"set_hash": int, "events": {"<id>": hash}}
+
+def sync_state_path(json_path: str) -> str:
+    return json_path + ".sync.json"
+
+def load_sync_state(path: str) -> Optional[Dict[str, Any]]:
+    if not os.path.exists(path):
+        return None
+    with open(path, "r", encoding="utf-8") as f:
+        return json.load(f)
+
+def save_sync_state(path: str, events: List[Dict[str, Any]]):
+    state = {"set_hash": set_hash(events), "events": {str(n["id"]): n["hash"] for n in events}}
+    with open(path, "w", encoding="utf-8") as f:
+        json.dump(state, f)
+
+def parse_status(raw: bytes) -> Dict[str, Any]:
+    """Status-Characteristic: proto=2;date=YYYY-MM-DD;events=<hex>;payload=<hex>;caps=<optionen>;batt=<0..11>"""
+    status: Dict[str, Any] = {}
+    for item in raw.decode("utf-8", "replace").strip().split(";"):
+        key, _, value = item.partition("=")
+        status[key] = int(value, 16) if key in ("events", "payload") else value
+    return status
+
+def prepare_upload(json_path: str, fmt: str, compress: bool, use_delta: bool, max_payload: int,
+                   status: Optional[Dict[str, Any]] = None):
+    """Liefert (header, data, events) für den Upload; data=None wenn nichts zu tun ist.
+    Mit `status` (vom Gerät gelesen) wird gegen den tatsächlichen Gerätestand entschieden;
+    ohne (ältere Firmware ohne Status-Characteristic) geht unkomprimiertes JSON per LEN:."""
+    events = load_normalized(json_path)
+    current_set = set_hash(events)
+    if status is None:
+        print("Kein Gerätestatus – sende unkomprimiertes JSON ohne Delta.")
+        fmt, compress, use_delta = "json", False, False
+    else:
+        today = datetime.now(ZoneInfo("Europe/Berlin")).strftime("%Y-%m-%d")
+        shown = device_events_hash(payload_order(events, fmt), today)
+        display_current = status.get("date") == today and status.get("events") == shown
+        print(f"Gerät: Payload {status.get('payload', 0):08x} (lokal {current_set:08x}), "
+              f"Anzeige {status.get('date') or '-'} {'aktuell' if display_current else 'veraltet'}")
+        if status.get("payload") == current_set:
+            print("Gerät hat diesen Kalender bereits – kein Upload.")
+            return None, None, events
+        caps = status.get("caps") or ""  # leer oder fehlend: keine Header-Optionen
+        compress = compress and "Z" in caps
+        use_delta = use_delta and "D" in caps
+    raw = build_payload(json_path, fmt)
+    base = None
+    state = load_sync_state(sync_state_path(json_path)) if use_delta else None
+    if state is not None and state.get("set_hash") != status.get("payload"):
+        print("Sync-Stand passt nicht zum Gerät – sende vollständig.")
+        state = None
+    if state is not None:
+        known = {int(k): v for k, v in state.get("events", {}).items()}
+        current = {n["id"] for n in events}
+        changed = [n for n in payload_order(events, fmt) if known.get(n["id"]) != n["hash"]]
+        deleted = [i for i in known if i not in current]
+        delta = encode_calendar_bin(changed, deleted)
+        if len(delta) < len(raw):
+            print(f"Delta: {len(changed)} geändert/neu, {len(deleted)} gelöscht ({len(delta)} B statt {len(raw)} B)")
+            raw = delta
+            base = state["set_hash"]
+    if len(raw) > max_payload:
+        print(f"Payload {len(raw)} > Limit {max_payload} – Abbruch.")
+        return None, None, None
+    data = compress_payload(raw) if compress else raw
+    if compress:
+        print(f"Payload {len(raw)} B, komprimiert {len(data)} B")
+    opts = ("Z" if compress else "") + ("D" if base is not None else "")
+    fields = [str(len(data))]
+    if compress:
+        fields.append(str(len(raw)))
+    if base is not None:
+        fields.append(str(base))
+    header = f"LEN{opts}:{':'.join(fields)}\n"
+    return header.encode("utf-8"), data, events
+
+def render_frame(json_path: str, calrender: str, today: str, stamp: str, battery: int) -> Optional[bytes]:
+    """Rendert `today` mit tools/render/calrender (Zeichencode der Firmware) als natives Panel-Bild."""
+    with tempfile.TemporaryDirectory() as tmp:
+        src = os.path.join(tmp, "calendar.bin")
+        with open(src, "wb") as f:
+            f.write(build_payload(json_path, "bin"))
+        native = os.path.join(tmp, "frame.bin")
+        cmd = [calrender, src, os.path.join(tmp, "frame.png"), "--date", today, "--time", stamp,
+               "--battery", str(battery), "--native", native]
+        try:
+            result = subprocess.run(cmd, capture_output=True, text=True)
+        except OSError as e:
+            print(f"calrender nicht ausführbar ({e}) – tools/render/build.sh bauen oder --calrender angeben.")
+            return None
+        if result.returncode != 0:
+            print(f"calrender fehlgeschlagen ({result.returncode}): {result.stderr.strip()}")
+            return None
+        with open(native, "rb") as f:
+            return f.read()
+
+def prepare_frame(json_path: str, calrender: str, status: Dict[str, Any]):
+    """Wie prepare_upload, aber als fertiges Panel-Bild (LENZP:): das Gerät parst, layoutet und
+    setzt nichts, es schreibt das Bild direkt ins Panel. Die Kalenderdatei auf dem Gerät bleibt."""
+    events = payload_order(load_normalized(json_path), "bin")
+    now = datetime.now(ZoneInfo("Europe/Berlin"))
+    today = now.strftime("%Y-%m-%d")
+    shown = device_events_hash(events, today)
+    if status.get("date") == today and status.get("events") == shown:
+        print("Anzeige bereits aktuell – kein Bild-Upload.")
+        return None, None, events
+    battery = int(status.get("batt") or 11)
+    raw = render_frame(json_path, calrender, today, now.strftime("%H:%M"), battery)
+    if raw is None or len(raw) != FRAME_BYTES:
+        if raw is not None:
+            print(f"Panel-Bild {len(raw)} B statt {FRAME_BYTES} B – Abbruch.")
+        return None, None, None
+    data = compress_payload(raw)
+    print(f"Panel-Bild {len(raw)} B, komprimiert {len(data)} B")
+    header = f"LENZP:{len(data)}:{len(raw)}:{shown}\n"
+    return header.encode("utf-8"), data, events
+
 # ---------------- BLE Send -----------------
-async def ble_send(json_path: str, address: Optional[str], chunk_size: int, max_payload: int, debug: bool = False, name_prefix: str = "CalSync", force_resp: bool = False, chunk_delay: float = 0.0, send_time: bool = False, time_only: bool = False):
+
+async def next_notify(queue: "asyncio.Queue[str]", timeout: float) -> Optional[str]:
+    try:
+        return await asyncio.wait_for(queue.get(), timeout)
+    except asyncio.TimeoutError:
+        return None
+
+class TransferStalled(Exception):
+    """Gerät antwortet nicht mehr oder hat den Transfer verworfen – per RESUME/neu versuchen."""
+
+def make_frame(offset: int, payload: bytes) -> bytes:
+    """Gerahmter Chunk (LENR:): Offset, Nutzdaten, CRC32 über beides (calParseFrame)."""
+    head = struct.pack("<I", offset)
+    return head + payload + struct.pack("<I", zlib.crc32(head + payload))
+
+def framed_header(header_bytes: bytes, transfer_id: int) -> bytes:
+    """LEN<opts>:<felder>\n -> LEN<opts>R:<felder>:<transferId>\n"""
+    opts, fields = header_bytes.decode("utf-8").rstrip("\n").split(":", 1)
+    return f"{opts}R:{fields}:{transfer_id}\n".encode("utf-8")
+
+async def send_with_credits(client, queue: "asyncio.Queue[str]", data_bytes: bytes, chunk_size: int, debug: bool,
+                            quiet: bool = False, start: int = 0, transfer_id: Optional[int] = None) -> Optional[Dict[str, float]]:
+    """Write-without-response im Rahmen der vom Gerät gewährten Credits (ACK:<empfangen>:<limit>).
+    Mit transfer_id werden die Chunks gerahmt; NAK:/RESUME: setzen den Sendezeiger auf den
+    ersten fehlenden Offset zurück. Liefert Host- und Gerätezeiten, None bei Gerätefehler;
+    TransferStalled, wenn das Gerät nicht mehr antwortet."""
+    length = len(data_bytes)
+    framed = transfer_id is not None
+    step = chunk_size - FRAME_OVERHEAD if framed else chunk_size
+    limit = 0
+    sent = start
+    result = None
+    probed = False
+    t0 = time.monotonic()
+
+    def handle(msg: str):
+        nonlocal limit, sent, result
+        kind, _, rest = msg.partition(":")
+        if kind == "ACK":
+            limit = max(limit, int(rest.split(":")[1]))
+        elif kind in ("NAK", "RESUME"):
+            sent = min(sent, int(rest))
+        elif msg == "ERR:NORESUME":
+            raise TransferStalled("Gerät hat den Transfer verworfen")
+        else:
+            result = msg  # DONE:/ERR:
+
+    while result is None:
+        while not queue.empty() and result is None:
+            handle(queue.get_nowait())
+        if result is not None:
+            break
+        if sent < length and sent < limit:
+            end = min(sent + step, limit, length)
+            part = data_bytes[sent:end]
+            await client.write_gatt_char(BLE_CHARACTERISTIC_UUID, make_frame(sent, part) if framed else part, response=False)
+            sent = end
+            if debug:
+                print(f"  Chunk gesendet: {sent}/{length} (Limit {limit})")
+            elif not quiet:
+                print(f"  Fortschritt: {sent}/{length} ({sent*100/length:.1f}%)", end='\r')
+            continue
+        # Fenster ausgeschöpft oder alles gesendet: auf Credits / Abschluss warten
+        msg = await next_notify(queue, BLE_ACK_TIMEOUT)
+        if msg is None:
+            if framed and not probed:
+                # Nachfragen statt abbrechen: Antwort ist der erste fehlende Offset
+                probed = True
+                await client.write_gatt_char(BLE_CHARACTERISTIC_UUID, f"RESUME:{transfer_id}\n".encode("utf-8"), response=True)
+                continue
+            raise TransferStalled(f"keine Antwort (gesendet {sent}/{length})")
+        probed = False
+        handle(msg)
+    if length and not debug and not quiet:
+        print()
+    elapsed = time.monotonic() - t0
+    if result.startswith("ERR:"):
+        print(f"Gerät meldet Fehler: {result[4:]}")
+        return None
+    fields = result.split(":")  # DONE:<bytes>:<ms>:<writes>
+    stats = {
+        "bytes": length,
+        "host_ms": elapsed * 1000,
+        "dev_ms": int(fields[2]),
+        "writes": int(fields[3]) if len(fields) > 3 else 0,
+    }
+    stats["host_kBps"] = length / stats["host_ms"] if stats["host_ms"] else 0.0
+    stats["dev_kBps"] = length / stats["dev_ms"] if stats["dev_ms"] else 0.0
+    if not quiet:
+        print(f"Übertragung abgeschlossen: {length} B in {stats['host_ms']:.0f} ms, Host {stats['host_kBps']:.1f} kB/s, "
+              f"Gerät {stats['dev_kBps']:.1f} kB/s ({stats['dev_ms']} ms, {stats['writes']} Writes)")
+    return stats
+
+async def request_resume(client, queue: "asyncio.Queue[str]", transfer_id: int) -> Optional[int]:
+    """Fragt nach einem Reconnect den ersten fehlenden Offset ab (None = Gerät hat nichts mehr)."""
+    while not queue.empty():
+        queue.get_nowait()
+    await client.write_gatt_char(BLE_CHARACTERISTIC_UUID, f"RESUME:{transfer_id}\n".encode("utf-8"), response=True)
+    while True:
+        msg = await next_notify(queue, BLE_ACK_TIMEOUT)
+        if msg is None or msg.startswith("ERR:"):
+            return None
+        if msg.startswith("RESUME:"):
+            return int(msg[7:])
+
+async def find_device(name_prefix: str, debug: bool) -> Optional[str]:
+    address = None
+    print(f"Scanne nach {name_prefix}...")
+    devices = await BleakScanner.discover(timeout=6.0)
+    if debug:
+        print(f"{len(devices)} Geräte gefunden.")
+    matches = []
+    for d in devices:
+        name = getattr(d, "name", "") or ""
+        md = getattr(d, "metadata", None)
+        uuids_list = []
+        if isinstance(md, dict):
+            raw = md.get("uuids") or md.get("service_uuids") or []
+            if isinstance(raw, (list, tuple)):
+                uuids_list = [u.lower() for u in raw if isinstance(u, str)]
+        cond = name.startswith(name_prefix) or (BLE_SERVICE_UUID.lower() in uuids_list)
+        if cond and not address:
+            address = getattr(d, 'address', None)
+            matches.append((name, address, uuids_list))
+    if not address:
+        print("Kein passendes Gerät gefunden. Gefundene Geräte:")
+        for d in devices:
+            print(f"  - {getattr(d,'name','?')} @ {getattr(d,'address','?')}")
+        return None
+    for (n,a,u) in matches:
+        print(f"Gefunden: {n} @ {a} uuids={u}")
+    return address
+
+async def subscribe_notify(client, debug: bool) -> Optional["asyncio.Queue[str]"]:
+    """Kanal für Credits/Quittungen; ältere Firmware hat ihn nicht -> None."""
+    queue: "asyncio.Queue[str]" = asyncio.Queue()
+    try:
+        await client.start_notify(BLE_NOTIFY_UUID, lambda _, d: queue.put_nowait(bytes(d).decode("utf-8", "replace").strip()))
+    except Exception as e:
+        if debug: print(f"Kein Notify-Kanal ({e}) – ohne Flusskontrolle")
+        return None
+    return queue
+
+async def send_legacy(client, header_bytes: bytes, data_bytes: bytes, chunk_size: int, debug: bool, force_resp: bool, chunk_delay: float) -> bool:
+    """Firmware ohne Notify-Kanal: Write-Response/Delay statt Credits."""
+    length = len(data_bytes)
+    # Wenn sehr kleine Payload (<= 40) -> Header + Payload zusammen versuchen
+    if length <= 40:
+        packet = header_bytes + data_bytes
+        if debug: print(f"Sende kombinierten Frame ({len(packet)} Bytes)")
+        await client.write_gatt_char(BLE_CHARACTERISTIC_UUID, packet, response=True)
+        print("Übertragung abgeschlossen (kombiniert).")
+        return True
+    print("Sende Header...")
+    await client.write_gatt_char(BLE_CHARACTERISTIC_UUID, header_bytes, response=True)
+    sent = 0
+    big_payload = length > 4000
+    if big_payload and not force_resp:
+        if debug: print("Aktiviere force_resp fuer grosse Payload")
+        force_resp = True
+    if big_payload and chunk_delay == 0.0:
+        chunk_delay = 0.01
+    # adapt chunk size conservatively if huge
+    if big_payload and chunk_size > 200:
+        chunk_size = 200
+    while sent < length:
+        part = data_bytes[sent:sent+chunk_size]
+        await client.write_gatt_char(BLE_CHARACTERISTIC_UUID, part, response=(force_resp or chunk_size < 30))
+        sent += len(part)
+        if debug:
+            print(f"  Chunk gesendet: {sent}/{length}")
+        else:
+            print(f"  Fortschritt: {sent}/{length} ({sent*100/length:.1f}%)", end='\r')
+        if chunk_delay > 0:
+            await asyncio.sleep(chunk_delay)
+    if not debug:
+        print()
+    print("Übertragung abgeschlossen.")
+    return True
+
+async def read_status(client, debug: bool) -> Optional[Dict[str, Any]]:
+    """Status-Characteristic lesen; ältere Firmware hat keins -> None."""
+    try:
+        status = parse_status(bytes(await client.read_gatt_char(BLE_STATUS_UUID)))
+    except Exception as e:
+        if debug: print(f"Kein Status-Characteristic ({e})")
+        return None
+    if debug: print(f"Gerätestatus: {status}")
+    return status
+
+async def ble_send(prepare: Optional[Callable[[Optional[Dict[str, Any]]], Tuple[Optional[bytes], Optional[bytes], Any]]], address: Optional[str], chunk_size: int, debug: bool = False, name_prefix: str = "CalSync", force_resp: bool = False, chunk_delay: float = 0.0, send_time: bool = False, time_only: bool = False, attempts: int = BLE_ATTEMPTS):
+    """`prepare(status)` liefert (header, data, ...) nach dem Lesen des Gerätestatus; data=None -> kein Upload."""
     if BleakScanner is None or BleakClient is None:
         print("Bleak nicht installiert (pip install bleak)")
         return False
-    if not os.path.exists(json_path):
-        print(f"Datei {json_path} existiert nicht.")
-        return False
-    with open(json_path, "r", encoding="utf-8") as f:
-        payload = f.read()
-    data_bytes = payload.encode("utf-8")
-    length = len(data_bytes)
-    if length > max_payload:
-        print(f"Payload {length} > Limit {max_payload} – Abbruch.")
+    if prepare is None and not send_time:
+        return True
+    time_only = time_only or prepare is None
+    header_bytes, data_bytes, framed = None, None, False
+    if not address:
+        address = await find_device(name_prefix, debug)
+        if not address:
+            return False
+    transfer_id = None  # gesetzt, sobald ein gerahmter Transfer läuft (RESUME nach Abbruch)
+    for attempt in range(1, attempts + 1):
+        print(f"Verbinde zu {address} ... (Versuch {attempt}/{attempts})")
+        try:
+            async with BleakClient(address) as client:
+                if not client.is_connected:
+                    print("Verbindung fehlgeschlagen.")
+                    continue
+                queue = await subscribe_notify(client, debug)
+                # Zeit vorab senden
+                if send_time and attempt == 1:
+                    epoch = int(time.time())
+                    time_hdr = f"TIME:{epoch}\n".encode("utf-8")
+                    if debug: print(f"Sende Zeit: {epoch}")
+                    await client.write_gatt_char(BLE_CHARACTERISTIC_UUID, time_hdr, response=True)
+                    if time_only:
+                        print("Nur Zeit gesendet.")
+                        return True
+                if attempt == 1:
+                    status = await read_status(client, debug)
+                    header_bytes, data_bytes, prepared = prepare(status)
+                    if data_bytes is None:
+                        return prepared is not None  # Gerät aktuell (True) bzw. Payload zu groß (False)
+                    framed = status is not None and "R" in status.get("caps", "")
+                chunk_size = min(chunk_size, max(20, getattr(client, "mtu_size", 23) - 3))
+                if queue is None:
+                    return await send_legacy(client, header_bytes, data_bytes, chunk_size, debug, force_resp, chunk_delay)
+                if not framed:
+                    # Credits ohne Rahmen (Firmware ohne Status/RESUME): bei Abbruch von vorn
+                    await client.write_gatt_char(BLE_CHARACTERISTIC_UUID, header_bytes, response=True)
+                    return await send_with_credits(client, queue, data_bytes, chunk_size, debug) is not None
+                # Gerahmt mit Credits: volle ATT-Payload pro Write, Tempo bestimmt das Gerät
+                start = 0
+                if transfer_id is not None:
+                    start = await request_resume(client, queue, transfer_id)
+                    if start is None:
+                        print("Gerät kennt den Transfer nicht mehr – Neustart.")
+                        transfer_id = None
+                    else:
+                        print(f"Setze Transfer bei {start}/{len(data_bytes)} fort.")
+                if transfer_id is None:
+                    transfer_id = zlib.crc32(data_bytes)
+                    start = 0
+                    print("Verbunden. Sende Header...")
+                    await client.write_gatt_char(BLE_CHARACTERISTIC_UUID, framed_header(header_bytes, transfer_id), response=True)
+                stats = await send_with_credits(client, queue, data_bytes, chunk_size, debug,
+                                                start=start, transfer_id=transfer_id)
+                return stats is not None
+        except (TransferStalled, BleakError, asyncio.TimeoutError, OSError) as e:
+            print(f"\nTransfer unterbrochen: {e}")
+            if attempt < attempts:
+                await asyncio.sleep(BLE_RETRY_DELAY)
+    print("Übertragung nach mehreren Versuchen abgebrochen.")
+    return False
+
+# ---------------- BLE Benchmark -----------------
+BENCH_SIZES = (4096, 16384, 60000)
+BENCH_CHUNKS = (20, 100, 0)  # 0 = MTU-3
+
+async def ble_bench(address: Optional[str], name_prefix: str, debug: bool, sizes=BENCH_SIZES, chunks=BENCH_CHUNKS) -> bool:
+    """Sendet synthetische Payloads (LENB:) in mehreren Größen/Chunkgrößen und misst den Durchsatz."""
+    if BleakScanner is None or BleakClient is None:
+        print("Bleak nicht installiert (pip install bleak)")
         return False
     if not address:
-        print(f"Scanne nach {name_prefix}...")
-        devices = await BleakScanner.discover(timeout=6.0)
-        if debug:
-            print(f"{len(devices)} Geräte gefunden.")
-        matches = []
-        for d in devices:
-            name = getattr(d, "name", "") or ""
-            md = getattr(d, "metadata", None)
-            uuids_list = []
-            if isinstance(md, dict):
-                raw = md.get("uuids") or md.get("service_uuids") or []
-                if isinstance(raw, (list, tuple)):
-                    uuids_list = [u.lower() for u in raw if isinstance(u, str)]
-            cond = name.startswith(name_prefix) or (BLE_SERVICE_UUID.lower() in uuids_list)
-            if cond and not address:
-                address = getattr(d, 'address', None)
-                matches.append((name, address, uuids_list))
+        address = await find_device(name_prefix, debug)
         if not address:
-            print("Kein passendes Gerät gefunden. Gefundene Geräte:")
-            for d in devices:
-                print(f"  - {getattr(d,'name','?')} @ {getattr(d,'address','?')}")
             return False
-        else:
-            for (n,a,u) in matches:
-                print(f"Gefunden: {n} @ {a} uuids={u}")
-    header_bytes = f"LEN:{length}\n".encode("utf-8")
-    # Wenn sehr kleine Payload (<= 40) -> Header + Payload zusammen versuchen
-    combined_mode = length <= 40
-    print(f"Verbinde zu {address} ... (combined_mode={combined_mode})")
     async with BleakClient(address) as client:
-        if not client.is_connected:
-            print("Verbindung fehlgeschlagen.")
+        queue = await subscribe_notify(client, debug)
+        if queue is None:
+            print("Benchmark braucht die Notify-Characteristic (aktuelle Firmware).")
             return False
-        # Zeit vorab senden
-        if send_time:
-            import time
-            epoch = int(time.time())
-            time_hdr = f"TIME:{epoch}\n".encode("utf-8")
-            if debug: print(f"Sende Zeit: {epoch}")
-            await client.write_gatt_char(BLE_CHARACTERISTIC_UUID, time_hdr, response=True)
-            if time_only:
-                print("Nur Zeit gesendet (--ble-time-only).")
-                return True
-        if combined_mode:
-            packet = header_bytes + data_bytes
-            if debug: print(f"Sende kombinierten Frame ({len(packet)} Bytes)")
-            await client.write_gatt_char(BLE_CHARACTERISTIC_UUID, packet, response=True)
-            print("Übertragung abgeschlossen (kombiniert).")
-            return True
-        # Normaler Modus: Erst Header
-        print("Verbunden. Sende Header...")
-        await client.write_gatt_char(BLE_CHARACTERISTIC_UUID, header_bytes, response=True)
-        sent = 0
-        big_payload = length > 4000
-        if big_payload and not force_resp:
-            if debug: print("Aktiviere force_resp fuer grosse Payload")
-            force_resp = True
-        if big_payload and chunk_delay == 0.0:
-            chunk_delay = 0.01
-        # adapt chunk size conservatively if huge
-        if big_payload and chunk_size > 200:
-            chunk_size = 200
-        while sent < length:
-            part = data_bytes[sent:sent+chunk_size]
-            await client.write_gatt_char(BLE_CHARACTERISTIC_UUID, part, response=(force_resp or chunk_size < 30))
-            sent += len(part)
-            if debug:
-                print(f"  Chunk gesendet: {sent}/{length}")
-            else:
-                print(f"  Fortschritt: {sent}/{length} ({sent*100/length:.1f}%)", end='\r')
-            if chunk_delay > 0:
-                await asyncio.sleep(chunk_delay)
-        if not debug:
-            print()
-        print("Übertragung abgeschlossen.")
+        mtu_chunk = max(20, getattr(client, "mtu_size", 23) - 3)
+        print(f"MTU {mtu_chunk + 3}")
+        results = []
+        for size in sizes:
+            for chunk in chunks:
+                chunk = mtu_chunk if chunk <= 0 else min(chunk, mtu_chunk)
+                await client.write_gatt_char(BLE_CHARACTERISTIC_UUID, f"LENB:{size}\n".encode("utf-8"), response=True)
+                try:
+                    stats = await send_with_credits(client, queue, os.urandom(size), chunk, debug, quiet=True)
+                except TransferStalled as e:
+                    print(f"Benchmark abgebrochen: {e}")
+                    return False
+                if stats is None:
+                    return False
+                stats["chunk"] = chunk
+                results.append(stats)
+                print(f"  {size:>6} B  chunk {chunk:>3}  Host {stats['host_ms']:>7.0f} ms {stats['host_kBps']:>6.1f} kB/s  "
+                      f"Gerät {stats['dev_ms']:>6} ms {stats['dev_kBps']:>6.1f} kB/s  {stats['writes']} Writes")
+        best = max(results, key=lambda r: r["dev_kBps"])
+        print(f"Bester Durchsatz: {best['dev_kBps']:.1f} kB/s ({best['bytes']} B, chunk {best['chunk']})")
     return True
 
 # ---------------- Main -----------------
@@ -224,7 +724,7 @@ def build_arg_parser():
     p.add_argument("--no-fetch", action="store_true", help="Skip Graph fetch, just BLE send existing file")
     p.add_argument("--ble", action="store_true", help="Send JSON via BLE after (or without) fetch")
     p.add_argument("--ble-address", help="BLE MAC/UUID (skip scan)")
-    p.add_argument("--chunk-size", type=int, default=180, help="BLE chunk bytes (<= MTU-3)")
+    p.add_argument("--chunk-size", type=int, default=244, help="BLE chunk bytes (capped at MTU-3)")
     p.add_argument("--max-payload", type=int, default=60000, help="Abort if JSON longer than this")
     p.add_argument("--ble-debug", action="store_true", help="Verbose BLE Scan/Send Logs")
     p.add_argument("--ble-name", default="CalSync", help="Name prefix to match (default CalSync)")
@@ -232,10 +732,18 @@ def build_arg_parser():
     p.add_argument("--ble-chunk-delay", type=float, default=0.0, help="Sleep seconds between BLE chunks (e.g. 0.02)")
     p.add_argument("--ble-send-time", action="store_true", help="Send current time (epoch UTC) before calendar")
     p.add_argument("--ble-time-only", action="store_true", help="Only send time (no calendar payload)")
+    p.add_argument("--format", choices=("bin", "json"), default="bin", help="Payload format: CalBin binary (default) or compact JSON")
+    p.add_argument("--full", action="store_true", help="Always send the full calendar (ignore delta sync state)")
+    p.add_argument("--no-compress", action="store_true", help="Send raw JSON (LEN:) instead of zlib (LENZ:)")
+    p.add_argument("--frame", action="store_true", help="Render the day on the host (calrender) and send the panel image (LENZP:) instead of calendar data")
+    p.add_argument("--calrender", default=CALRENDER, help="Host renderer binary for --frame (default tools/render/calrender)")
+    p.add_argument("--bench", action="store_true", help="BLE throughput benchmark with synthetic payloads (no calendar upload)")
     return p
 
 def main():
     args = build_arg_parser().parse_args()
+    if args.bench:
+        return 0 if asyncio.run(ble_bench(args.ble_address, args.ble_name, args.ble_debug)) else 1
     client_id = args.client_id or (input('Client ID: '))
     tenant_id = args.tenant_id or (input('Tenant ID: '))
     condensed: List[Dict[str, Any]] = []
@@ -257,18 +765,48 @@ def main():
 
     if args.ble:
         print("Starte BLE Übertragung...")
-        ok = asyncio.run(ble_send(
-            args.output,
-            args.ble_address,
-            args.chunk_size,
-            args.max_payload,
-            args.ble_debug,
-            args.ble_name,
-            args.ble_force_response,
-            args.ble_chunk_delay,
-            args.ble_send_time,
-            args.ble_time_only
-        ))
+        plan: Dict[str, Any] = {}
+
+        def planner(full: bool):
+            def prepare(status: Optional[Dict[str, Any]]):
+                plan["frame"] = args.frame and status is not None and "P" in status.get("caps", "")
+                if plan["frame"]:
+                    plan["header"], plan["data"], plan["events"] = prepare_frame(args.output, args.calrender, status)
+                    return plan["header"], plan["data"], plan["events"]
+                if args.frame:
+                    print("Gerät nimmt keine Panel-Bilder an (caps ohne P) – sende Kalenderdaten.")
+                # Deltas gibt es nur im Binärformat (Hashes beziehen sich auf die CalBin-Darstellung)
+                use_delta = args.format == "bin" and not full
+                plan["header"], plan["data"], plan["events"] = prepare_upload(
+                    args.output, args.format, not args.no_compress, use_delta, args.max_payload, status)
+                return plan["header"], plan["data"], plan["events"]
+            return None if args.ble_time_only else prepare
+
+        def send(prepare) -> bool:
+            return asyncio.run(ble_send(
+                prepare,
+                args.ble_address,
+                args.chunk_size,
+                args.ble_debug,
+                args.ble_name,
+                args.ble_force_response,
+                args.ble_chunk_delay,
+                args.ble_send_time,
+                args.ble_time_only
+            ))
+        ok = send(planner(args.full))
+        header = plan.get("header")
+        if not ok and header and b"D" in header.split(b":")[0]:
+            # z.B. ERR:DELTA – Gerät hat einen anderen Stand als die Sync-Datei
+            print("Delta-Upload fehlgeschlagen – sende vollständigen Kalender.")
+            ok = send(planner(True))
+        if ok and plan.get("events") is not None and not plan.get("frame"):
+            # auch ohne Upload (Gerät war aktuell) den Sync-Stand nachziehen
+            state_path = sync_state_path(args.output)
+            if args.format == "bin":
+                save_sync_state(state_path, plan["events"])
+            elif os.path.exists(state_path):
+                os.remove(state_path)
         return 0 if ok else 1
     return 0
 
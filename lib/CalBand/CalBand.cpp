@@ -0,0 +1,77 @@
+// CalBand.cpp
+#include "CalBand.h"
+#include <string.h>
+
+CalBand::CalBand(int16_t panelWidth, int16_t panelHeight, uint8_t* buffer, uint16_t rows)
+    : Adafruit_GFX(panelWidth, panelHeight), _buffer(buffer), _rows(rows) {}
+
+uint8_t CalBand::color4(uint16_t color) {
+    switch (color) {
+        case 0x0000: return 0; // GxEPD_BLACK
+        case 0xFFFF: return 1; // GxEPD_WHITE
+        case 0xFFE0: return 2; // GxEPD_YELLOW
+        case 0xF800: return 3; // GxEPD_RED
+    }
+    // Any other color: each channel counts from half intensity (GxEPD_DARKGREY -> black)
+    bool r = (color & 0xF800) >= 0x8000;
+    bool g = ((color & 0x07E0) << 5) >= 0x8000;
+    bool b = ((color & 0x001F) << 11) >= 0x8000;
+    if (r && g && b) return 1;
+    if (r && g) return 2;
+    if (r) return 3;
+    return 0;
+}
+
+// Screen -> panel position (as GxEPD2 rotates), then relative to the band
+bool CalBand::toBand(int16_t& x, int16_t& y) const {
+    if (x < 0 || x >= width() || y < 0 || y >= height()) return false;
+    int16_t t;
+    switch (getRotation()) {
+        case 1: t = x; x = WIDTH - y - 1; y = t; break;
+        case 2: x = WIDTH - x - 1; y = HEIGHT - y - 1; break;
+        case 3: t = x; x = y; y = HEIGHT - t - 1; break;
+    }
+    y -= _first;
+    return y >= 0 && y < (int16_t)rows();
+}
+
+void CalBand::drawPixel(int16_t x, int16_t y, uint16_t color) {
+    _writes++;
+    if (!toBand(x, y)) return;
+    size_t i = (size_t)y * (WIDTH / 4) + x / 4;
+    uint8_t shift = (uint8_t)((3 - x % 4) * 2);
+    _buffer[i] = (uint8_t)((_buffer[i] & ~(0x03 << shift)) | color4(color) << shift);
+}
+
+void CalBand::fillScreen(uint16_t color) {
+    uint8_t pv = color4(color);
+    memset(_buffer, pv | pv << 2 | pv << 4 | pv << 6, bytes());
+    _writes += (uint32_t)WIDTH * rows();
+}
+
+void CalBand::begin(uint16_t firstRow, const CalRowImage* background) {
+    _first = firstRow;
+    if (!background || background->width != WIDTH || background->height != HEIGHT) {
+        memset(_buffer, 0x55, bytes()); // white
+        return;
+    }
+    // PROGMEM is memory-mapped on the ESP32, so the rows are copied directly
+    size_t rowBytes = WIDTH / 4;
+    for (uint16_t r = 0; r < rows(); r++)
+        memcpy(_buffer + r * rowBytes, background->rows + (size_t)background->index[_first + r] * rowBytes, rowBytes);
+}
+
+void CalBand::screenRect(int16_t& x, int16_t& y, int16_t& w, int16_t& h) const {
+    int16_t n = (int16_t)rows();
+    switch (getRotation()) {
+        case 0: x = 0; y = _first; w = WIDTH; h = n; break;
+        case 1: x = _first; y = 0; w = n; h = WIDTH; break;
+        case 2: x = 0; y = HEIGHT - _first - n; w = WIDTH; h = n; break;
+        default: x = HEIGHT - _first - n; y = 0; w = n; h = WIDTH; break;
+    }
+}
+
+uint8_t CalBand::pixel(int16_t x, int16_t y) const {
+    if (!toBand(x, y)) return 1;
+    return (_buffer[(size_t)y * (WIDTH / 4) + x / 4] >> ((3 - x % 4) * 2)) & 0x03;
+}
@@ -0,0 +1,63 @@
+// CalBand.h - a band of full panel rows in native 2-bit format as an Adafruit_GFX target
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <Adafruit_GFX.h>
+
+// A panel-native image (2 bit per pixel, full rows) stored as its distinct
+// rows plus one index entry per panel row. Mostly uniform pictures such as
+// the static calendar background shrink to a few KB of flash this way, and a
+// row is still copied with a single memcpy.
+struct CalRowImage {
+    uint16_t width;          // panel pixels
+    uint16_t height;
+    const uint8_t* rows;     // distinct rows, width / 4 bytes each
+    const uint16_t* index;   // per panel row: its number in `rows`
+};
+
+// Draws like GxEPD2_4C into a caller-owned buffer of `rows` full panel rows:
+// same rotation mapping, same RGB565 -> 4-color reduction, same byte layout
+// (4 pixels per byte, MSB first; black 0, white 1, yellow 2, red 3). Only
+// drawPixel and fillScreen are overridden, like in GxEPD2_4C, so every other
+// primitive produces the same pixels. Pixels outside the band are dropped.
+//
+// Unlike GxEPD2's private page buffer, the band can be pre-filled from flash
+// (begin() with a CalRowImage) before the dynamic content is drawn on top.
+// Full frames are a band with rows == panel height (tools/render).
+class CalBand : public Adafruit_GFX {
+public:
+    // `panelWidth` x `panelHeight` in native orientation (width a multiple of 4);
+    // `buffer` holds panelWidth / 4 * rows bytes.
+    CalBand(int16_t panelWidth, int16_t panelHeight, uint8_t* buffer, uint16_t rows);
+
+    void drawPixel(int16_t x, int16_t y, uint16_t color) override;
+    void fillScreen(uint16_t color) override; // the band only
+
+    // Moves the band to panel rows [firstRow, firstRow + rows()) and fills it
+    // from `background` (same panel size) or white.
+    void begin(uint16_t firstRow, const CalRowImage* background = nullptr);
+
+    uint16_t firstRow() const { return _first; }
+    // Rows of the current band (the last band of the panel may be shorter)
+    uint16_t rows() const { return _first + _rows <= HEIGHT ? _rows : HEIGHT - _first; }
+    const uint8_t* buffer() const { return _buffer; }
+    size_t bytes() const { return (size_t)WIDTH / 4 * rows(); }
+    // The band in screen coordinates of the current rotation, e.g. as clip
+    // rectangle for CalDisplayList::replay()
+    void screenRect(int16_t& x, int16_t& y, int16_t& w, int16_t& h) const;
+    // 4-color value at a screen position (white outside the band)
+    uint8_t pixel(int16_t x, int16_t y) const;
+    // drawPixel calls so far; fillScreen counts the band's area, begin nothing
+    uint32_t pixelWrites() const { return _writes; }
+
+    // RGB565 -> 4-color value, as GxEPD2_4C reduces colors
+    static uint8_t color4(uint16_t color);
+
+private:
+    bool toBand(int16_t& x, int16_t& y) const;
+
+    uint8_t* _buffer;
+    uint16_t _rows;
+    uint16_t _first = 0;
+    uint32_t _writes = 0;
+};
@@ -0,0 +1,191 @@
+// CalBin.cpp
+#include "CalBin.h"
+#include <string.h>
+
+namespace {
+const uint32_t FNV_OFFSET = 2166136261u;
+const uint32_t FNV_PRIME = 16777619u;
+
+uint16_t rd16(const uint8_t* p) { return (uint16_t)(p[0] | (p[1] << 8)); }
+uint32_t rd32(const uint8_t* p) { return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24); }
+void wr16(std::vector<uint8_t>& o, uint16_t v) { o.push_back((uint8_t)v); o.push_back((uint8_t)(v >> 8)); }
+void wr32(std::vector<uint8_t>& o, uint32_t v) { wr16(o, (uint16_t)v); wr16(o, (uint16_t)(v >> 16)); }
+
+uint32_t fnv(uint32_t h, const void* data, size_t len) {
+    const uint8_t* p = (const uint8_t*)data;
+    while (len--) { h ^= *p++; h *= FNV_PRIME; }
+    return h;
+}
+uint32_t fnvStr(uint32_t h, const char* s) { return fnv(h, s, strlen(s) + 1); }
+
+// Copies a string table entry; the table is known to end with a NUL.
+void copyString(const char* table, uint32_t tableLen, uint16_t off, char* dst, size_t cap) {
+    if (off >= tableLen) { dst[0] = '\0'; return; }
+    const char* s = table + off;
+    size_t n = strnlen(s, tableLen - off);
+    if (n >= cap) {
+        n = cap - 1;
+        while (n > 0 && ((uint8_t)s[n] & 0xC0) == 0x80) --n; // keep UTF-8 sequences whole
+    }
+    memcpy(dst, s, n);
+    dst[n] = '\0';
+}
+
+// String table builder with linear dedup (a week has a few hundred strings at most).
+struct StringTable {
+    std::vector<uint8_t> data;
+    std::vector<uint32_t> offsets;
+    StringTable() { data.push_back(0); }
+    bool intern(const char* s, uint16_t& off) {
+        size_t len = strlen(s);
+        if (len == 0) { off = 0; return true; }
+        for (uint32_t o : offsets) {
+            if (o + len + 1 <= data.size() && memcmp(&data[o], s, len + 1) == 0) { off = (uint16_t)o; return true; }
+        }
+        if (data.size() + len + 1 > 0xFFFF) return false;
+        off = (uint16_t)data.size();
+        offsets.push_back(off);
+        data.insert(data.end(), (const uint8_t*)s, (const uint8_t*)s + len + 1);
+        return true;
+    }
+};
+}
+
+bool calBinIsBinary(const uint8_t* buf, size_t len) {
+    return len >= sizeof(CALBIN_MAGIC) && memcmp(buf, CALBIN_MAGIC, sizeof(CALBIN_MAGIC)) == 0;
+}
+
+uint8_t calBinFlags(const CalStreamEvent& evt) {
+    uint8_t f = 0;
+    if (evt.isImportant)     f |= CALBIN_IMPORTANT;
+    if (evt.isOnlineMeeting) f |= CALBIN_ONLINE;
+    if (evt.isRecurring)     f |= CALBIN_RECURRING;
+    if (evt.isMoved)         f |= CALBIN_MOVED;
+    if (evt.hasAttachments)  f |= CALBIN_ATTACHMENTS;
+    if (evt.isCanceled)      f |= CALBIN_CANCELLED;
+    if (evt.hasTitle)        f |= CALBIN_HAS_TITLE;
+    if (evt.end[0])          f |= CALBIN_HAS_END;
+    return f;
+}
+
+uint32_t calBinEventHash(const CalStreamEvent& evt) {
+    uint32_t h = FNV_OFFSET;
+    h = fnvStr(h, evt.start);
+    h = fnvStr(h, evt.end);
+    h = fnvStr(h, evt.hasTitle ? evt.title : "");
+    h = fnvStr(h, evt.organizer);
+    h = fnvStr(h, evt.location);
+    uint8_t f = calBinFlags(evt);
+    return fnv(h, &f, 1);
+}
+
+void CalBinSetHash::add(uint32_t id, uint32_t hash) {
+    uint8_t b[8] = {(uint8_t)id, (uint8_t)(id >> 8), (uint8_t)(id >> 16), (uint8_t)(id >> 24),
+                    (uint8_t)hash, (uint8_t)(hash >> 8), (uint8_t)(hash >> 16), (uint8_t)(hash >> 24)};
+    sum += fnv(FNV_OFFSET, b, sizeof(b));
+    ++count;
+}
+
+bool calBinDecodeOps(const uint8_t* buf, size_t len, CalBinSink sink, void* ctx, size_t* eventCount) {
+    if (eventCount) *eventCount = 0;
+    if (len < CALBIN_HEADER_SIZE || !calBinIsBinary(buf, len)) return false;
+    uint8_t version = buf[4];
+    if (version != 1 && version != 2) return false;
+    size_t recSize = version == 1 ? CALBIN_V1_RECORD_SIZE : sizeof(CalBinRecord);
+    uint16_t count = rd16(buf + 6);
+    uint32_t tableLen = rd32(buf + 8);
+    size_t recordsEnd = CALBIN_HEADER_SIZE + (size_t)count * recSize;
+    if (recordsEnd > len || len - recordsEnd != tableLen) return false;
+    if (tableLen == 0 || buf[len - 1] != '\0') return false;
+    const char* table = (const char*)buf + recordsEnd;
+
+    CalStreamEvent evt;
+    for (uint16_t i = 0; i < count; ++i) {
+        const uint8_t* r = buf + CALBIN_HEADER_SIZE + (size_t)i * recSize;
+        memset(&evt, 0, sizeof(evt));
+        if (version >= 2) {
+            evt.id = rd32(r);
+            evt.hasId = true;
+            r += 4;
+        }
+        uint32_t start = rd32(r);
+        uint16_t duration = rd16(r + 4);
+        int16_t offset = (int16_t)rd16(r + 6);
+        uint8_t flags = r[8];
+        uint8_t op = version >= 2 ? r[9] : (uint8_t)CALBIN_OP_UPSERT;
+        calTimeFromEpoch(start, offset, evt.startTime);
+        calTimeFormatIso(evt.startTime, evt.start, sizeof(evt.start));
+        evt.hasStartTime = true;
+        if (flags & CALBIN_HAS_END) {
+            calTimeFromEpoch(start + (uint32_t)duration * 60, offset, evt.endTime);
+            calTimeFormatIso(evt.endTime, evt.end, sizeof(evt.end));
+            evt.hasEndTime = true;
+        }
+        copyString(table, tableLen, rd16(r + 10), evt.title, sizeof(evt.title));
+        copyString(table, tableLen, rd16(r + 12), evt.organizer, sizeof(evt.organizer));
+        copyString(table, tableLen, rd16(r + 14), evt.location, sizeof(evt.location));
+        evt.hasTitle        = flags & CALBIN_HAS_TITLE;
+        evt.isImportant     = flags & CALBIN_IMPORTANT;
+        evt.isOnlineMeeting = flags & CALBIN_ONLINE;
+        evt.isRecurring     = flags & CALBIN_RECURRING;
+        evt.isMoved         = flags & CALBIN_MOVED;
+        evt.hasAttachments  = flags & CALBIN_ATTACHMENTS;
+        evt.isCanceled      = flags & CALBIN_CANCELLED;
+        if (sink) sink(evt, op, ctx);
+        if (eventCount) *eventCount = i + 1;
+    }
+    return true;
+}
+
+namespace {
+struct PlainSink { CalStreamSink sink; void* ctx; };
+void forwardUpserts(const CalStreamEvent& evt, uint8_t op, void* ctx) {
+    PlainSink* p = (PlainSink*)ctx;
+    if (op == CALBIN_OP_UPSERT && p->sink) p->sink(evt, p->ctx);
+}
+}
+
+bool calBinDecode(const uint8_t* buf, size_t len, CalStreamSink sink, void* ctx, size_t* eventCount) {
+    PlainSink p = {sink, ctx};
+    return calBinDecodeOps(buf, len, forwardUpserts, &p, eventCount);
+}
+
+bool calBinEncode(const CalStreamEvent* events, size_t count, std::vector<uint8_t>& out) {
+    StringTable table;
+    std::vector<uint8_t> records;
+    records.reserve(count * sizeof(CalBinRecord));
+    uint16_t written = 0;
+    for (size_t i = 0; i < count && written < 0xFFFF; ++i) {
+        const CalStreamEvent& e = events[i];
+        if (!e.hasStartTime) continue;
+        uint32_t start = e.startTime.epoch;
+        uint16_t duration = 0;
+        if (e.hasEndTime && e.endTime.epoch > start) {
+            uint32_t mins = (e.endTime.epoch - start) / 60;
+            duration = mins > 0xFFFF ? 0xFFFF : (uint16_t)mins;
+        }
+        uint16_t t, o, l;
+        if (!table.intern(e.hasTitle ? e.title : "", t) || !table.intern(e.organizer, o) ||
+            !table.intern(e.location, l)) return false;
+        wr32(records, calBinEventId(e));
+        wr32(records, start);
+        wr16(records, duration);
+        wr16(records, (uint16_t)e.startTime.offsetMin);
+        records.push_back(calBinFlags(e));
+        records.push_back(CALBIN_OP_UPSERT);
+        wr16(records, t);
+        wr16(records, o);
+        wr16(records, l);
+        ++written;
+    }
+    out.clear();
+    out.reserve(CALBIN_HEADER_SIZE + records.size() + table.data.size());
+    out.insert(out.end(), CALBIN_MAGIC, CALBIN_MAGIC + sizeof(CALBIN_MAGIC));
+    out.push_back(CALBIN_VERSION);
+    out.push_back(0);
+    wr16(out, written);
+    wr32(out, (uint32_t)table.data.size());
+    out.insert(out.end(), records.begin(), records.end());
+    out.insert(out.end(), table.data.begin(), table.data.end());
+    return true;
+}
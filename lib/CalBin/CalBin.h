@@ -0,0 +1,87 @@
+// CalBin.h - compact binary calendar format (wire + flash)
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+#include <CalStream.h>
+
+// Layout (little endian):
+//   0  char[4]  magic "ECAL"
+//   4  u8       version (1 or 2)
+//   5  u8       reserved (0)
+//   6  u16      event count
+//   8  u32      string table size in bytes
+//  12  records[count] (CalBinRecord, v1 without the leading id)
+//   .. string table: NUL-terminated UTF-8 strings, offset 0 is always ""
+// Strings are deduplicated, so repeated organizers / locations cost 2 bytes.
+// v2 adds a per-event id and an op byte used by delta uploads (LEND:).
+static const char CALBIN_MAGIC[4] = {'E', 'C', 'A', 'L'};
+static const uint8_t CALBIN_VERSION = 2;
+static const size_t CALBIN_HEADER_SIZE = 12;
+static const size_t CALBIN_V1_RECORD_SIZE = 16;
+
+enum CalBinFlags : uint8_t {
+    CALBIN_IMPORTANT   = 1 << 0,
+    CALBIN_ONLINE      = 1 << 1,
+    CALBIN_RECURRING   = 1 << 2,
+    CALBIN_MOVED       = 1 << 3,
+    CALBIN_ATTACHMENTS = 1 << 4,
+    CALBIN_CANCELLED   = 1 << 5,
+    CALBIN_HAS_TITLE   = 1 << 6,
+    CALBIN_HAS_END     = 1 << 7,
+};
+
+enum CalBinOp : uint8_t {
+    CALBIN_OP_UPSERT = 0, // stored documents only contain upserts
+    CALBIN_OP_DELETE = 1, // delta only: remove the event with this id
+};
+
+#pragma pack(push, 1)
+struct CalBinRecord {
+    uint32_t id;           // v2 only
+    uint32_t startEpoch;   // UTC seconds
+    uint16_t durationMin;  // end - start
+    int16_t  utcOffsetMin; // local offset of start/end (e.g. +120 for CEST)
+    uint8_t  flags;        // CalBinFlags
+    uint8_t  op;           // CalBinOp (v1: reserved)
+    uint16_t titleOff;     // offsets into the string table
+    uint16_t organizerOff;
+    uint16_t locationOff;
+};
+#pragma pack(pop)
+static_assert(sizeof(CalBinRecord) == 20, "CalBinRecord must stay 20 bytes");
+
+// Called per record; `op` is CALBIN_OP_UPSERT for normal documents.
+typedef void (*CalBinSink)(const CalStreamEvent& evt, uint8_t op, void* ctx);
+
+// True if the buffer starts with the CalBin magic.
+bool calBinIsBinary(const uint8_t* buf, size_t len);
+
+// Validates the document and emits one CalStreamEvent per record (startTime /
+// endTime come straight from epoch + offset, the ISO strings are rebuilt), so
+// binary and JSON uploads share the same consumer. v1 records get their
+// content hash as id. Returns false on a malformed document.
+bool calBinDecode(const uint8_t* buf, size_t len, CalStreamSink sink, void* ctx, size_t* eventCount = nullptr);
+bool calBinDecodeOps(const uint8_t* buf, size_t len, CalBinSink sink, void* ctx, size_t* eventCount = nullptr);
+
+// Encodes events as a v2 document (all upserts). Events without a parsed
+// start (hasStartTime) are skipped. Returns false if the string table would
+// exceed 64 KB.
+bool calBinEncode(const CalStreamEvent* events, size_t count, std::vector<uint8_t>& out);
+
+// Flag byte as stored in CalBin (also part of the event hash).
+uint8_t calBinFlags(const CalStreamEvent& evt);
+// FNV-1a over start, end, title, organizer, location (each NUL-terminated)
+// and the flag byte. Mirrored by event_hash() in cal.py.
+uint32_t calBinEventHash(const CalStreamEvent& evt);
+// Id from the payload, or the content hash for events without one.
+inline uint32_t calBinEventId(const CalStreamEvent& evt) { return evt.hasId ? evt.id : calBinEventHash(evt); }
+
+// Order-independent hash over the (id, hash) pairs of a whole event set.
+// Used as base for delta uploads; mirrored by set_hash() in cal.py.
+struct CalBinSetHash {
+    uint32_t sum = 0;
+    uint32_t count = 0;
+    void add(uint32_t id, uint32_t hash);
+    uint32_t value() const { return sum ^ (count * 0x9E3779B1u); }
+};
@@ -0,0 +1,113 @@
+// CalDays.cpp
+#include "CalDays.h"
+#include <string.h>
+
+namespace {
+const size_t DATE_LEN = 10;
+const size_t BOX_SIZE = 10;
+
+uint16_t rd16(const uint8_t* p) { return (uint16_t)(p[0] | (p[1] << 8)); }
+uint32_t rd32(const uint8_t* p) { return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24); }
+void wr16(std::vector<uint8_t>& o, uint16_t v) { o.push_back((uint8_t)v); o.push_back((uint8_t)(v >> 8)); }
+void wr32(std::vector<uint8_t>& o, uint32_t v) { wr16(o, (uint16_t)v); wr16(o, (uint16_t)(v >> 16)); }
+}
+
+void CalDaysWriter::begin(uint32_t setHash) {
+    _setHash = setHash;
+    _lastDate[0] = '\0';
+    _index.clear();
+    _records.clear();
+}
+
+bool CalDaysWriter::addDay(const char* date, const CalEventDay& day, const std::vector<CalLayoutBox>& boxes) {
+    if (strlen(date) < DATE_LEN || dayCount() >= CALDAYS_MAX_DAYS || day.size() > 0xFFFF) return false;
+    if (_lastDate[0] && strncmp(date, _lastDate, DATE_LEN) <= 0) return false;
+    if (boxes.size() != day.size()) return false;
+    size_t start = _records.size();
+    wr16(_records, (uint16_t)day.size());
+    wr16(_records, (uint16_t)day.poolSize());
+    const uint8_t* ev = (const uint8_t*)day.events();
+    _records.insert(_records.end(), ev, ev + day.size() * sizeof(CalEvent));
+    _records.insert(_records.end(), day.pool(), day.pool() + day.poolSize());
+    for (const CalLayoutBox& b : boxes) {
+        wr16(_records, (uint16_t)b.eventIndex);
+        wr16(_records, (uint16_t)b.startMin);
+        wr16(_records, (uint16_t)b.endMin);
+        _records.push_back((uint8_t)b.column);
+        _records.push_back((uint8_t)b.groupColumns);
+        _records.push_back((uint8_t)b.colSpan);
+        _records.push_back(0);
+    }
+    size_t length = _records.size() - start;
+    if (length > 0xFFFF) { _records.resize(start); return false; }
+    _index.insert(_index.end(), (const uint8_t*)date, (const uint8_t*)date + DATE_LEN);
+    wr32(_index, day.hash());
+    wr32(_index, (uint32_t)start); // relative to the records, fixed up in finish()
+    wr16(_index, (uint16_t)length);
+    memcpy(_lastDate, date, DATE_LEN);
+    _lastDate[DATE_LEN] = '\0';
+    return true;
+}
+
+void CalDaysWriter::finish(std::vector<uint8_t>& out) {
+    size_t base = CALDAYS_HEADER_SIZE + _index.size();
+    for (size_t i = 0; i < _index.size(); i += CALDAYS_INDEX_ENTRY_SIZE) {
+        uint8_t* off = &_index[i + DATE_LEN + 4];
+        uint32_t v = rd32(off) + (uint32_t)base;
+        off[0] = (uint8_t)v; off[1] = (uint8_t)(v >> 8); off[2] = (uint8_t)(v >> 16); off[3] = (uint8_t)(v >> 24);
+    }
+    out.clear();
+    out.reserve(base + _records.size());
+    out.insert(out.end(), CALDAYS_MAGIC, CALDAYS_MAGIC + sizeof(CALDAYS_MAGIC));
+    out.push_back(CALDAYS_VERSION);
+    out.push_back((uint8_t)dayCount());
+    wr16(out, 0);
+    wr32(out, _setHash);
+    out.insert(out.end(), _index.begin(), _index.end());
+    out.insert(out.end(), _records.begin(), _records.end());
+}
+
+bool calDaysReadHeader(const uint8_t* buf, size_t len, CalDaysHeader& out) {
+    if (len < CALDAYS_HEADER_SIZE || memcmp(buf, CALDAYS_MAGIC, sizeof(CALDAYS_MAGIC)) != 0) return false;
+    if (buf[4] != CALDAYS_VERSION) return false;
+    out.dayCount = buf[5];
+    out.setHash = rd32(buf + 8);
+    return true;
+}
+
+bool calDaysFind(const uint8_t* index, size_t len, const CalDaysHeader& h, const char* date, CalDaysIndexEntry& out) {
+    if (len < calDaysIndexSize(h) || strlen(date) < DATE_LEN) return false;
+    size_t lo = 0, hi = h.dayCount;
+    while (lo < hi) {
+        size_t mid = (lo + hi) / 2;
+        const uint8_t* e = index + mid * CALDAYS_INDEX_ENTRY_SIZE;
+        int c = memcmp(e, date, DATE_LEN);
+        if (c < 0) { lo = mid + 1; continue; }
+        if (c > 0) { hi = mid; continue; }
+        memcpy(out.date, e, DATE_LEN);
+        out.date[DATE_LEN] = '\0';
+        out.eventsHash = rd32(e + DATE_LEN);
+        out.offset = rd32(e + DATE_LEN + 4);
+        out.length = rd16(e + DATE_LEN + 8);
+        return true;
+    }
+    return false;
+}
+
+bool calDaysDecodeDay(const uint8_t* rec, size_t len, CalEventDay& day, std::vector<CalLayoutBox>& boxes) {
+    day.clear();
+    boxes.clear();
+    if (len < 4) return false;
+    size_t count = rd16(rec);
+    size_t poolLen = rd16(rec + 2);
+    size_t eventsLen = count * sizeof(CalEvent);
+    if (len != 4 + eventsLen + poolLen + count * BOX_SIZE) return false;
+    if (!day.assign(rec + 4, count, (const char*)rec + 4 + eventsLen, poolLen)) return false;
+    boxes.reserve(count);
+    for (const uint8_t* b = rec + 4 + eventsLen + poolLen; b < rec + len; b += BOX_SIZE) {
+        size_t idx = rd16(b);
+        if (idx >= count) { day.clear(); boxes.clear(); return false; }
+        boxes.push_back({idx, b[6], b[7], b[8], rd16(b + 2), rd16(b + 4)});
+    }
+    return true;
+}
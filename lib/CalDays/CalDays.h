@@ -0,0 +1,66 @@
+// CalDays.h - per-day layout cache (flash), indexed by date
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+#include <CalEvents.h>
+#include <CalLayout.h>
+
+// Layout (little endian):
+//   0  char[4]  magic "EDAY"
+//   4  u8       version (3)
+//   5  u8       day count
+//   6  u16      reserved (0)
+//   8  u32      set hash of the calendar the cache was built from
+//  12  index[dayCount], sorted by date:
+//        char[10] date "YYYY-MM-DD", u32 events hash, u32 record offset, u16 record length
+//  .. day records: u16 event count, u16 pool size, CalEvent[count] (12 bytes
+//        each, as in memory), string pool, then one box per event in drawing
+//        order: u16 eventIndex, u16 startMin, u16 endMin, u8 column,
+//        u8 groupColumns, u8 colSpan, u8 reserved
+// A day record is the CalEventDay blocks plus the resolved layout; the index
+// holds its redraw hash. Days that are not in the index have no events.
+static const char CALDAYS_MAGIC[4] = {'E', 'D', 'A', 'Y'};
+static const uint8_t CALDAYS_VERSION = 3; // v3: spans from the corrected layout
+static const size_t CALDAYS_HEADER_SIZE = 12;
+static const size_t CALDAYS_INDEX_ENTRY_SIZE = 20;
+static const size_t CALDAYS_MAX_DAYS = 255;
+
+struct CalDaysHeader {
+    uint8_t dayCount;
+    uint32_t setHash;
+};
+
+struct CalDaysIndexEntry {
+    char date[11];
+    uint32_t eventsHash;
+    uint32_t offset;       // from the start of the file
+    uint16_t length;
+};
+
+// Builds a cache file in memory. Days must be added in ascending date order.
+class CalDaysWriter {
+public:
+    void begin(uint32_t setHash);
+    // `boxes` is the layout of `day` (computeCalendarLayout). Returns false if
+    // the day is out of order or the cache would get too large.
+    bool addDay(const char* date, const CalEventDay& day, const std::vector<CalLayoutBox>& boxes);
+    void finish(std::vector<uint8_t>& out);
+    size_t dayCount() const { return _index.size() / CALDAYS_INDEX_ENTRY_SIZE; }
+
+private:
+    uint32_t _setHash = 0;
+    char _lastDate[11] = "";
+    std::vector<uint8_t> _index;
+    std::vector<uint8_t> _records;
+};
+
+// Validates magic/version; the index (dayCount entries) follows the header.
+bool calDaysReadHeader(const uint8_t* buf, size_t len, CalDaysHeader& out);
+inline size_t calDaysIndexSize(const CalDaysHeader& h) { return (size_t)h.dayCount * CALDAYS_INDEX_ENTRY_SIZE; }
+
+// Binary search over the index (the bytes after the header).
+bool calDaysFind(const uint8_t* index, size_t len, const CalDaysHeader& h, const char* date, CalDaysIndexEntry& out);
+
+// Loads one day record. Returns false on a malformed record.
+bool calDaysDecodeDay(const uint8_t* rec, size_t len, CalEventDay& day, std::vector<CalLayoutBox>& boxes);
@@ -0,0 +1,166 @@
+// CalDisplayList.cpp
+#include "CalDisplayList.h"
+#include <string.h>
+
+namespace {
+enum : uint8_t { OP_FILL = 1, OP_LINE = 2, OP_TEXT = 3 };
+const size_t OP_HEADER = 11;
+const size_t TEXT_FONT = OP_HEADER + 4;
+const size_t TEXT_LENGTH = TEXT_FONT + sizeof(const GFXfont*);
+const size_t TEXT_CHARS = TEXT_LENGTH + 1;
+const uint8_t TEXT_MAX = 255;
+
+uint16_t rd16(const uint8_t* p) { return (uint16_t)(p[0] | (p[1] << 8)); }
+int16_t rdi16(const uint8_t* p) { return (int16_t)rd16(p); }
+void wr16(std::vector<uint8_t>& o, uint16_t v) { o.push_back((uint8_t)v); o.push_back((uint8_t)(v >> 8)); }
+void put16(uint8_t* p, uint16_t v) { p[0] = (uint8_t)v; p[1] = (uint8_t)(v >> 8); }
+
+bool intersects(const uint8_t* op, int16_t x, int16_t y, int16_t w, int16_t h) {
+    int16_t ox = rdi16(op + 1), oy = rdi16(op + 3), ow = rdi16(op + 5), oh = rdi16(op + 7);
+    return ow > 0 && oh > 0 && ox < x + w && x < ox + ow && oy < y + h && y < oy + oh;
+}
+}
+
+CalDisplayList::CalDisplayList(int16_t width, int16_t height) : Adafruit_GFX(width, height) {}
+
+void CalDisplayList::clear() {
+    _ops.clear();
+    _count = 0;
+    _fill = _text = SIZE_MAX;
+}
+
+size_t CalDisplayList::begin(uint8_t type, int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color) {
+    size_t at = _ops.size();
+    _ops.push_back(type);
+    wr16(_ops, (uint16_t)x);
+    wr16(_ops, (uint16_t)y);
+    wr16(_ops, (uint16_t)w);
+    wr16(_ops, (uint16_t)h);
+    wr16(_ops, color);
+    _count++;
+    _fill = _text = SIZE_MAX;
+    return at;
+}
+
+void CalDisplayList::grow(size_t op, int16_t x, int16_t y, int16_t w, int16_t h) {
+    uint8_t* p = &_ops[op];
+    int16_t ox = rdi16(p + 1), oy = rdi16(p + 3), ow = rdi16(p + 5), oh = rdi16(p + 7);
+    if (ow > 0 && oh > 0) {
+        int16_t x1 = ox + ow > x + w ? ox + ow : x + w;
+        int16_t y1 = oy + oh > y + h ? oy + oh : y + h;
+        if (ox < x) x = ox;
+        if (oy < y) y = oy;
+        w = x1 - x;
+        h = y1 - y;
+    }
+    put16(p + 1, (uint16_t)x);
+    put16(p + 3, (uint16_t)y);
+    put16(p + 5, (uint16_t)w);
+    put16(p + 7, (uint16_t)h);
+}
+
+void CalDisplayList::drawPixel(int16_t x, int16_t y, uint16_t color) {
+    fillRect(x, y, 1, 1, color);
+}
+
+void CalDisplayList::fillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color) {
+    if (w <= 0 || h <= 0) return;
+    if (_measuring) {
+        grow(_text, x, y, w, h);
+        return;
+    }
+    // Continue a one-row run (bitmaps arrive pixel by pixel, left to right)
+    if (h == 1 && _fill != SIZE_MAX) {
+        uint8_t* p = &_ops[_fill];
+        int16_t ox = rdi16(p + 1), ow = rdi16(p + 5);
+        if (rdi16(p + 3) == y && rd16(p + 9) == color && ox + ow == x) {
+            put16(p + 5, (uint16_t)(ow + w));
+            return;
+        }
+    }
+    size_t at = begin(OP_FILL, x, y, w, h, color);
+    if (h == 1) _fill = at;
+}
+
+void CalDisplayList::drawFastHLine(int16_t x, int16_t y, int16_t w, uint16_t color) {
+    fillRect(x, y, w, 1, color);
+}
+
+void CalDisplayList::drawFastVLine(int16_t x, int16_t y, int16_t h, uint16_t color) {
+    fillRect(x, y, 1, h, color);
+}
+
+void CalDisplayList::drawLine(int16_t x0, int16_t y0, int16_t x1, int16_t y1, uint16_t color) {
+    if (x0 == x1 || y0 == y1) {
+        int16_t x = x0 < x1 ? x0 : x1, y = y0 < y1 ? y0 : y1;
+        fillRect(x, y, (int16_t)(x0 < x1 ? x1 - x0 : x0 - x1) + 1, (int16_t)(y0 < y1 ? y1 - y0 : y0 - y1) + 1, color);
+        return;
+    }
+    int16_t x = x0 < x1 ? x0 : x1, y = y0 < y1 ? y0 : y1;
+    begin(OP_LINE, x, y, (int16_t)((x0 < x1 ? x1 - x0 : x0 - x1) + 1), (int16_t)((y0 < y1 ? y1 - y0 : y0 - y1) + 1), color);
+    wr16(_ops, (uint16_t)x0);
+    wr16(_ops, (uint16_t)y0);
+    wr16(_ops, (uint16_t)x1);
+    wr16(_ops, (uint16_t)y1);
+}
+
+size_t CalDisplayList::write(uint8_t c) {
+    bool extend = _text != SIZE_MAX && cursor_x == _textEndX && cursor_y == _textEndY &&
+                  rd16(&_ops[_text + 9]) == textcolor && _ops[_text + TEXT_LENGTH] < TEXT_MAX;
+    if (extend) {
+        const GFXfont* font;
+        memcpy(&font, &_ops[_text + TEXT_FONT], sizeof(font));
+        extend = font == gfxFont;
+    }
+    if (!extend) {
+        size_t at = begin(OP_TEXT, 0, 0, 0, 0, textcolor);
+        wr16(_ops, (uint16_t)cursor_x);
+        wr16(_ops, (uint16_t)cursor_y);
+        const GFXfont* font = gfxFont;
+        const uint8_t* p = (const uint8_t*)&font;
+        _ops.insert(_ops.end(), p, p + sizeof(font));
+        _ops.push_back(0);
+        _text = at;
+    }
+    _ops.push_back(c);
+    _ops[_text + TEXT_LENGTH]++;
+    // Let Adafruit_GFX move the cursor (wrapping, newlines); its pixels only size the box
+    _measuring = true;
+    Adafruit_GFX::write(c);
+    _measuring = false;
+    _textEndX = cursor_x;
+    _textEndY = cursor_y;
+    return 1;
+}
+
+void CalDisplayList::replay(Adafruit_GFX& gfx, int16_t clipX, int16_t clipY, int16_t clipW, int16_t clipH) const {
+    const uint8_t* p = _ops.data();
+    const uint8_t* end = p + _ops.size();
+    while (p < end) {
+        uint8_t type = p[0];
+        size_t len = type == OP_LINE ? OP_HEADER + 8 : type == OP_TEXT ? TEXT_CHARS + p[TEXT_LENGTH] : OP_HEADER;
+        if (intersects(p, clipX, clipY, clipW, clipH)) {
+            uint16_t color = rd16(p + 9);
+            if (type == OP_FILL) {
+                // Clipped here: a page buffer still sees every pixel of a fillRect
+                int16_t x = rdi16(p + 1), y = rdi16(p + 3);
+                int16_t x1 = x + rdi16(p + 5), y1 = y + rdi16(p + 7);
+                if (x < clipX) x = clipX;
+                if (y < clipY) y = clipY;
+                if (x1 > clipX + clipW) x1 = clipX + clipW;
+                if (y1 > clipY + clipH) y1 = clipY + clipH;
+                gfx.fillRect(x, y, x1 - x, y1 - y, color);
+            } else if (type == OP_LINE) {
+                gfx.drawLine(rdi16(p + 11), rdi16(p + 13), rdi16(p + 15), rdi16(p + 17), color);
+            } else {
+                const GFXfont* font;
+                memcpy(&font, p + TEXT_FONT, sizeof(font));
+                gfx.setFont(font);
+                gfx.setTextColor(color);
+                gfx.setCursor(rdi16(p + 11), rdi16(p + 13));
+                gfx.write(p + TEXT_CHARS, p[TEXT_LENGTH]);
+            }
+        }
+        p += len;
+    }
+}
@@ -0,0 +1,56 @@
+// CalDisplayList.h - recorded drawing operations, replayed page by page
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+#include <Adafruit_GFX.h>
+
+// A paged display buffers only a band of the panel and needs the whole picture
+// drawn once per band. CalDisplayList is a draw target that records the picture
+// once (rectangles, lines, pixel runs, text runs), so every page is a replay:
+// text is wrapped and measured at record time and only rasterized on replay.
+// Each op keeps its bounding box; ops outside the replayed area are skipped.
+//
+// Text is recorded per character (Print::write) together with the font, color
+// and start cursor, so it replays pixel-identical on a target of the same size.
+// Only text size 1 on a transparent background is supported. Single pixels
+// (bitmaps) are merged into horizontal runs.
+//
+// Op layout (little endian, ops back to back):
+//   0  u8   type (FILL, LINE, TEXT)
+//   1  i16  x, y, w, h   bounding box (FILL: the rectangle itself)
+//   9  u16  color
+//  LINE: 11  i16 x0, y0, x1, y1
+//  TEXT: 11  i16 cursor x, y; font pointer; u8 length; characters
+class CalDisplayList : public Adafruit_GFX {
+public:
+    CalDisplayList(int16_t width, int16_t height);
+
+    void drawPixel(int16_t x, int16_t y, uint16_t color) override;
+    void fillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color) override;
+    void drawFastHLine(int16_t x, int16_t y, int16_t w, uint16_t color) override;
+    void drawFastVLine(int16_t x, int16_t y, int16_t h, uint16_t color) override;
+    void drawLine(int16_t x0, int16_t y0, int16_t x1, int16_t y1, uint16_t color) override;
+    size_t write(uint8_t c) override;
+    using Print::write;
+
+    void reserve(size_t bytes) { _ops.reserve(bytes); }
+    void clear();
+    size_t bytes() const { return _ops.size(); }
+    size_t count() const { return _count; }
+
+    // Draws the ops whose bounding box intersects the clip rectangle, in
+    // recording order. Pixels outside it may still be drawn (the target clips).
+    void replay(Adafruit_GFX& gfx, int16_t clipX, int16_t clipY, int16_t clipW, int16_t clipH) const;
+
+private:
+    size_t begin(uint8_t type, int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color);
+    void grow(size_t op, int16_t x, int16_t y, int16_t w, int16_t h);
+
+    std::vector<uint8_t> _ops;
+    size_t _count = 0;
+    size_t _fill = SIZE_MAX;  // last op if it is a one-row FILL (run to extend)
+    size_t _text = SIZE_MAX;  // open TEXT op
+    int16_t _textEndX = 0, _textEndY = 0; // cursor after its last character
+    bool _measuring = false;  // inside Adafruit_GFX::write: pixels only grow the box
+};
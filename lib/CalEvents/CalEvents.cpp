@@ -0,0 +1,106 @@
+// CalEvents.cpp
+#include "CalEvents.h"
+#include <string.h>
+
+namespace {
+const uint32_t FNV_OFFSET = 2166136261u;
+const uint32_t FNV_PRIME = 16777619u;
+
+uint32_t fnv(uint32_t h, const void* data, size_t len) {
+    const uint8_t* p = (const uint8_t*)data;
+    while (len--) { h ^= *p++; h *= FNV_PRIME; }
+    return h;
+}
+
+// Removes every occurrence of `pat` without rescanning the result (like String::replace(pat, ""))
+void removeAll(char* s, const char* pat) {
+    size_t n = strlen(pat);
+    char* w = s;
+    for (const char* r = s; *r;) {
+        if (strncmp(r, pat, n) == 0) r += n;
+        else *w++ = *r++;
+    }
+    *w = '\0';
+}
+}
+
+void CalEventDay::clear() {
+    _events.clear();
+    _pool.assign(1, '\0');
+}
+
+void CalEventDay::reserve(size_t events, size_t poolBytes) {
+    _events.reserve(events);
+    _pool.reserve(poolBytes + 1);
+}
+
+// Linear dedup: a day has a handful of events, repeated organizers/locations are common.
+bool CalEventDay::intern(const char* s, uint16_t& off) {
+    size_t len = s ? strlen(s) : 0;
+    if (len == 0) { off = 0; return true; }
+    for (size_t o = 1; o + len < _pool.size(); o += strlen(&_pool[o]) + 1) {
+        if (memcmp(&_pool[o], s, len + 1) == 0) { off = (uint16_t)o; return true; }
+    }
+    if (_pool.size() + len + 1 > 0xFFFF) return false;
+    off = (uint16_t)_pool.size();
+    _pool.insert(_pool.end(), s, s + len + 1);
+    return true;
+}
+
+bool CalEventDay::add(uint16_t startMin, uint16_t endMin, uint8_t flags,
+                      const char* title, const char* organizer, const char* location) {
+    CalEvent e = {startMin, endMin, flags, 0, 0, 0, 0};
+    if (!intern(title, e.titleOff) || !intern(organizer, e.organizerOff) || !intern(location, e.locationOff))
+        return false;
+    _events.push_back(e);
+    return true;
+}
+
+bool CalEventDay::assign(const void* events, size_t count, const char* pool, size_t poolLen) {
+    clear();
+    if (poolLen == 0 || poolLen > 0xFFFF || pool[0] != '\0' || pool[poolLen - 1] != '\0') return false;
+    _events.resize(count);
+    memcpy(_events.data(), events, count * sizeof(CalEvent));
+    for (const CalEvent& e : _events) {
+        if (e.titleOff >= poolLen || e.organizerOff >= poolLen || e.locationOff >= poolLen) { clear(); return false; }
+    }
+    _pool.assign(pool, pool + poolLen);
+    return true;
+}
+
+uint32_t CalEventDay::hash() const {
+    uint32_t h = FNV_OFFSET;
+    for (const CalEvent& e : _events) {
+        uint8_t head[5] = {(uint8_t)e.startMin, (uint8_t)(e.startMin >> 8),
+                           (uint8_t)e.endMin, (uint8_t)(e.endMin >> 8), e.flags};
+        h = fnv(h, head, sizeof(head));
+        const char* t = str(e.titleOff);
+        const char* o = str(e.organizerOff);
+        const char* l = str(e.locationOff);
+        h = fnv(h, t, strlen(t) + 1);
+        h = fnv(h, o, strlen(o) + 1);
+        h = fnv(h, l, strlen(l) + 1);
+    }
+    return h;
+}
+
+uint16_t calEventEndMin(const CalTime& start, const CalTime& end) {
+    uint32_t duration = end.epoch > start.epoch ? (end.epoch - start.epoch) / 60 : 0;
+    uint32_t m = start.minutes + duration;
+    return (uint16_t)(m > 24 * 60 ? 24 * 60 : m);
+}
+
+void calEventDisplayLocation(const char* in, char* out, size_t cap) {
+    size_t len = strlen(in);
+    size_t left = 0, right = len;
+    if (strncmp(in, "; ", 2) == 0) { // truncate long URLs (like String::substring(2, len - 2))
+        left = 2; right = len - 2;
+        if (left > right) { size_t t = left; left = right; right = t; }
+    }
+    size_t n = right - left < cap - 1 ? right - left : cap - 1;
+    memcpy(out, in + left, n);
+    out[n] = '\0';
+    removeAll(out, "DE-");
+    removeAll(out, "HB-");
+    removeAll(out, "COC-");
+}
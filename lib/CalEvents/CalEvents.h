@@ -0,0 +1,66 @@
+// CalEvents.h - compact per-day event model (fixed-size records + string pool)
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+#include <CalTime.h>
+
+// One event as displayed. Strings live in the pool of the owning CalEventDay.
+struct CalEvent {
+    uint16_t startMin;     // minutes from local midnight
+    uint16_t endMin;       // minutes from the same midnight, at most 1440 (0 without CALBIN_HAS_END)
+    uint8_t  flags;        // CalBinFlags
+    uint8_t  reserved;
+    uint16_t titleOff;     // offsets into the pool, offset 0 is always ""
+    uint16_t organizerOff;
+    uint16_t locationOff;
+};
+static_assert(sizeof(CalEvent) == 12, "CalEvent must stay 12 bytes");
+
+// All events of one day: a contiguous record array plus a deduplicated,
+// NUL-separated string pool. A day is hashed, copied and stored as these two
+// blocks; no per-event heap objects.
+class CalEventDay {
+public:
+    CalEventDay() { clear(); }
+    void clear();
+    void reserve(size_t events, size_t poolBytes);
+    // Appends an event (strings are interned). Returns false if the pool
+    // would exceed 64 KB.
+    bool add(uint16_t startMin, uint16_t endMin, uint8_t flags,
+             const char* title, const char* organizer, const char* location);
+    // Replaces the content with previously stored blocks (`events` may be
+    // unaligned). Returns false (and leaves the day empty) if the pool is
+    // malformed or an offset is out of range.
+    bool assign(const void* events, size_t count, const char* pool, size_t poolLen);
+
+    size_t size() const { return _events.size(); }
+    bool empty() const { return _events.empty(); }
+    const CalEvent& operator[](size_t i) const { return _events[i]; }
+    const char* str(uint16_t off) const { return &_pool[off]; }
+    const CalEvent* events() const { return _events.data(); }
+    const char* pool() const { return _pool.data(); }
+    size_t poolSize() const { return _pool.size(); }
+
+    // Redraw hash: FNV-1a over, per event, startMin and endMin (u16 LE), the
+    // flag byte and title, organizer, location (each NUL-terminated). An empty
+    // day hashes to the FNV offset basis. Mirrored by device_events_hash() in cal.py.
+    uint32_t hash() const;
+
+private:
+    bool intern(const char* s, uint16_t& off);
+
+    std::vector<CalEvent> _events;
+    std::vector<char> _pool;
+};
+
+// Title of events that have none. Mirrored by cal.py.
+static const char CALEVENT_NO_TITLE[] = "(kein Titel)";
+
+// Location as displayed: a leading "; " list is trimmed at both ends and the
+// site prefixes "DE-", "HB-", "COC-" are removed. Mirrored by device_events_hash() in cal.py.
+void calEventDisplayLocation(const char* in, char* out, size_t cap);
+
+// End of an event as CalEvent::endMin: start.minutes plus the duration,
+// clamped to the end of the start day. An end before the start gives start.minutes.
+uint16_t calEventEndMin(const CalTime& start, const CalTime& end);
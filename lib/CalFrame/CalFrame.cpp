@@ -0,0 +1,97 @@
+// CalFrame.cpp
+#include "CalFrame.h"
+#include <string.h>
+
+namespace {
+const uint32_t FNV_OFFSET = 2166136261u;
+const uint32_t FNV_PRIME = 16777619u;
+
+uint16_t rd16(const uint8_t* p) { return (uint16_t)(p[0] | (p[1] << 8)); }
+uint32_t rd32(const uint8_t* p) { return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24); }
+void wr16(std::vector<uint8_t>& o, uint16_t v) { o.push_back((uint8_t)v); o.push_back((uint8_t)(v >> 8)); }
+void wr32(std::vector<uint8_t>& o, uint32_t v) { wr16(o, (uint16_t)v); wr16(o, (uint16_t)(v >> 16)); }
+
+size_t tilesX(uint16_t width) { return (width + CALFRAME_TILE - 1) / CALFRAME_TILE; }
+size_t tilesY(uint16_t height) { return (height + CALFRAME_TILE - 1) / CALFRAME_TILE; }
+}
+
+size_t calFrameTileCount(uint16_t width, uint16_t height) {
+    return tilesX(width) * tilesY(height);
+}
+
+void calFrameDigest(const uint8_t* frame, uint16_t width, uint16_t height, std::vector<uint32_t>& out) {
+    const size_t rowBytes = width / 4;
+    const size_t tileBytes = CALFRAME_TILE / 4;
+    const size_t tx = tilesX(width);
+    out.assign(calFrameTileCount(width, height), FNV_OFFSET);
+    // Row by row, so the frame is read sequentially.
+    for (uint16_t y = 0; y < height; ++y) {
+        const uint8_t* row = frame + (size_t)y * rowBytes;
+        uint32_t* digests = &out[(y / CALFRAME_TILE) * tx];
+        for (size_t t = 0; t < tx; ++t) {
+            size_t begin = t * tileBytes;
+            size_t end = begin + tileBytes < rowBytes ? begin + tileBytes : rowBytes;
+            uint32_t h = digests[t];
+            for (size_t i = begin; i < end; ++i) { h ^= row[i]; h *= FNV_PRIME; }
+            digests[t] = h;
+        }
+    }
+}
+
+bool calFrameDiff(const std::vector<uint32_t>& prev, const std::vector<uint32_t>& next,
+                  uint16_t width, uint16_t height, CalFrameRect& dirty,
+                  const CalFrameRect* ignore, size_t* changedTiles) {
+    const size_t tx = tilesX(width), ty = tilesY(height);
+    // ignored tile range [ix0, ix1) x [iy0, iy1)
+    size_t ix0 = 0, ix1 = 0, iy0 = 0, iy1 = 0;
+    if (ignore && ignore->w && ignore->h) {
+        ix0 = ignore->x / CALFRAME_TILE;
+        iy0 = ignore->y / CALFRAME_TILE;
+        ix1 = (ignore->x + ignore->w + CALFRAME_TILE - 1) / CALFRAME_TILE;
+        iy1 = (ignore->y + ignore->h + CALFRAME_TILE - 1) / CALFRAME_TILE;
+    }
+    size_t x0 = tx, y0 = ty, x1 = 0, y1 = 0, changed = 0;
+    for (size_t row = 0; row < ty; ++row) {
+        for (size_t col = 0; col < tx; ++col) {
+            size_t i = row * tx + col;
+            if (i < prev.size() && i < next.size() && prev[i] == next[i]) continue;
+            if (col >= ix0 && col < ix1 && row >= iy0 && row < iy1) continue;
+            ++changed;
+            if (col < x0) x0 = col;
+            if (row < y0) y0 = row;
+            if (col + 1 > x1) x1 = col + 1;
+            if (row + 1 > y1) y1 = row + 1;
+        }
+    }
+    if (changedTiles) *changedTiles = changed;
+    if (!changed) { dirty = {0, 0, 0, 0}; return false; }
+    size_t right = x1 * CALFRAME_TILE < width ? x1 * CALFRAME_TILE : width;
+    size_t bottom = y1 * CALFRAME_TILE < height ? y1 * CALFRAME_TILE : height;
+    dirty.x = (uint16_t)(x0 * CALFRAME_TILE);
+    dirty.y = (uint16_t)(y0 * CALFRAME_TILE);
+    dirty.w = (uint16_t)(right - dirty.x);
+    dirty.h = (uint16_t)(bottom - dirty.y);
+    return true;
+}
+
+void calFrameEncode(const std::vector<uint32_t>& digests, uint16_t width, uint16_t height, std::vector<uint8_t>& out) {
+    out.clear();
+    out.reserve(CALFRAME_HEADER_SIZE + digests.size() * 4);
+    out.insert(out.end(), CALFRAME_MAGIC, CALFRAME_MAGIC + sizeof(CALFRAME_MAGIC));
+    out.push_back(CALFRAME_VERSION);
+    out.push_back((uint8_t)CALFRAME_TILE);
+    wr16(out, width);
+    wr16(out, height);
+    wr16(out, 0);
+    for (uint32_t d : digests) wr32(out, d);
+}
+
+bool calFrameDecode(const uint8_t* buf, size_t len, uint16_t width, uint16_t height, std::vector<uint32_t>& out) {
+    size_t count = calFrameTileCount(width, height);
+    if (len != CALFRAME_HEADER_SIZE + count * 4 || memcmp(buf, CALFRAME_MAGIC, sizeof(CALFRAME_MAGIC)) != 0) return false;
+    if (buf[4] != CALFRAME_VERSION || buf[5] != CALFRAME_TILE || rd16(buf + 6) != width || rd16(buf + 8) != height)
+        return false;
+    out.resize(count);
+    for (size_t i = 0; i < count; ++i) out[i] = rd32(buf + CALFRAME_HEADER_SIZE + i * 4);
+    return true;
+}
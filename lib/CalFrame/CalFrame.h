@@ -0,0 +1,44 @@
+// CalFrame.h - tile digests of a packed 2-bit frame (diff against the last displayed frame)
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+// The frame is the panel's native buffer: 2 bits per pixel, 4 pixels per byte,
+// rows of width / 4 bytes. It is split into 16x16 pixel tiles (the last
+// column/row may be smaller); each tile gets an FNV-1a digest. Two frames
+// with equal digests are treated as pixel-identical.
+//
+// Stored layout (little endian):
+//   0  char[4]  magic "EFRM"
+//   4  u8       version (1)
+//   5  u8       tile size in pixels (16)
+//   6  u16      width
+//   8  u16      height
+//  10  u16      reserved (0)
+//  12  u32      digests[tilesX * tilesY], row-major
+static const char CALFRAME_MAGIC[4] = {'E', 'F', 'R', 'M'};
+static const uint8_t CALFRAME_VERSION = 1;
+static const size_t CALFRAME_HEADER_SIZE = 12;
+static const uint16_t CALFRAME_TILE = 16;
+
+// Tile-aligned area in frame pixels.
+struct CalFrameRect {
+    uint16_t x, y, w, h;
+};
+
+size_t calFrameTileCount(uint16_t width, uint16_t height);
+
+// Digests of all tiles of `frame` (width must be a multiple of 4).
+void calFrameDigest(const uint8_t* frame, uint16_t width, uint16_t height, std::vector<uint32_t>& out);
+
+// Bounding box of the tiles that differ. Returns false (and an empty rect) if
+// all digests are equal. Tiles touching `ignore` (e.g. a clock) do not count.
+// `changedTiles` (optional) receives the count.
+bool calFrameDiff(const std::vector<uint32_t>& prev, const std::vector<uint32_t>& next,
+                  uint16_t width, uint16_t height, CalFrameRect& dirty,
+                  const CalFrameRect* ignore = nullptr, size_t* changedTiles = nullptr);
+
+void calFrameEncode(const std::vector<uint32_t>& digests, uint16_t width, uint16_t height, std::vector<uint8_t>& out);
+// False if the buffer is malformed or was made for another geometry.
+bool calFrameDecode(const uint8_t* buf, size_t len, uint16_t width, uint16_t height, std::vector<uint32_t>& out);
@@ -0,0 +1,55 @@
+// CalInflate.cpp
+#include "CalInflate.h"
+#include <stdlib.h>
+#include <rom/miniz.h> // tinfl in ROM, costs no flash
+
+bool CalInflate::reserve() {
+    if (!_state) _state = (tinfl_decompressor*)malloc(sizeof(tinfl_decompressor));
+    return _state != nullptr;
+}
+
+bool CalInflate::begin(uint8_t* out, size_t outCap) {
+    end();
+    if (!reserve()) return false;
+    tinfl_init(_state);
+    _out = out;
+    _outCap = outCap;
+    _outPos = 0;
+    _done = false;
+    _active = true;
+    return true;
+}
+
+bool CalInflate::feed(const uint8_t* in, size_t len, size_t& produced) {
+    produced = 0;
+    if (!_active) return false;
+    while (len > 0) {
+        if (_done) return false; // trailing garbage after the stream
+        size_t inBytes = len;
+        size_t outBytes = _outCap - _outPos;
+        tinfl_status st = tinfl_decompress(_state, in, &inBytes, _out, _out + _outPos, &outBytes,
+                                           TINFL_FLAG_PARSE_ZLIB_HEADER |
+                                           TINFL_FLAG_USING_NON_WRAPPING_OUTPUT_BUF |
+                                           TINFL_FLAG_HAS_MORE_INPUT |
+                                           TINFL_FLAG_COMPUTE_ADLER32);
+        in += inBytes;
+        len -= inBytes;
+        _outPos += outBytes;
+        produced += outBytes;
+        if (st == TINFL_STATUS_DONE) { _done = true; continue; }
+        if (st < 0) return false;
+        // Output full while the stream still has data -> declared raw size too small
+        if (st == TINFL_STATUS_HAS_MORE_OUTPUT) return false;
+        if (inBytes == 0 && outBytes == 0) return false; // no progress
+    }
+    return true;
+}
+
+void CalInflate::end() {
+    _active = false;
+}
+
+void CalInflate::release() {
+    end();
+    if (_state) { free(_state); _state = nullptr; }
+}
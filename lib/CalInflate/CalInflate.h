@@ -0,0 +1,38 @@
+// CalInflate.h - streaming zlib inflate into a caller-owned buffer
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+struct tinfl_decompressor_tag;
+
+// Wraps the miniz tinfl decompressor from the ESP32 ROM. Input may arrive in
+// arbitrary pieces; output is written linearly into `out`, which must hold the
+// whole inflated payload (so no separate dictionary window is needed).
+class CalInflate {
+public:
+    ~CalInflate() { release(); }
+    // Allocates the decompressor state (~11 KB) once; it is reused by every
+    // following stream, so transfers do not cycle a large block through the heap.
+    bool reserve();
+    // Starts one stream (calls reserve() if needed).
+    bool begin(uint8_t* out, size_t outCap);
+    // Consumes all of `in`. `produced` receives the number of bytes appended
+    // at out + outLen() before the call. Returns false on corrupt data or if
+    // the stream inflates to more than outCap bytes.
+    bool feed(const uint8_t* in, size_t len, size_t& produced);
+    // True once the zlib stream (incl. Adler-32 trailer) was fully decoded.
+    bool done() const { return _done; }
+    size_t outLen() const { return _outPos; }
+    // Ends the stream; the state stays reserved.
+    void end();
+    // Frees the state.
+    void release();
+
+private:
+    tinfl_decompressor_tag* _state = nullptr;
+    uint8_t* _out = nullptr;
+    size_t _outCap = 0;
+    size_t _outPos = 0;
+    bool _done = false;
+    bool _active = false;
+};
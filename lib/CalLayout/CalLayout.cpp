@@ -1,124 +1,109 @@
 // CalLayout.cpp
 #include "CalLayout.h"
 #include <algorithm>
+#include <functional>
+#include <queue>
+#include <CalBin.h>
 
 namespace {
 struct IntervalTmp {
     size_t idx;
     int startMin; // minutes from midnight
     int endMin;   // minutes from midnight
-    String startIso;
-    String endIso;
+    int rawEndMin; // resolved end, before the 1h fallback for inverted events
 };
 
-int parseMinutes(const String& iso) {
-    int t = iso.indexOf('T');
-    if (t < 0 || iso.length() < t + 6) return 0;
-    int h = iso.substring(t+1, t+3).toInt();
-    int m = iso.substring(t+4, t+6).toInt();
-    return h * 60 + m;
+// Events without end last one hour (hour clamped to 23, as drawn)
+int resolvedEnd(const CalEvent& e) {
+    if (e.flags & CALBIN_HAS_END) return e.endMin;
+    int h = e.startMin / 60 + 1;
+    if (h >= 24) h = 23;
+    return h * 60 + e.startMin % 60;
 }
 
-String plusOneHour(const String& iso) {
-    int t = iso.indexOf('T');
-    if (t < 0 || iso.length() < t + 6) return iso;
-    int year = iso.substring(0,4).toInt();
-    int mon  = iso.substring(5,7).toInt();
-    int day  = iso.substring(8,10).toInt();
-    int h    = iso.substring(t+1, t+3).toInt();
-    int mi   = iso.substring(t+4, t+6).toInt();
-    h += 1;
-    if (h >= 24) h = 23; // clamp (simple)
-    char buf[32];
-    snprintf(buf, sizeof(buf), "%04d-%02d-%02dT%02d:%02d:00+0000", year, mon, day, h, mi);
-    return String(buf);
+// Intervals of one column, in start order. They never overlap, so their ends
+// ascend as well and an overlap query is a single binary search.
+bool columnOverlaps(const std::vector<const IntervalTmp*>& column, int startMin, int endMin) {
+    auto it = std::upper_bound(column.begin(), column.end(), startMin,
+                               [](int s, const IntervalTmp* iv) { return s < iv->endMin; });
+    return it != column.end() && (*it)->startMin < endMin;
+}
+
+typedef std::pair<int, int> EndColumn; // (endMin, column)
+
+// Spans of one finished overlap group (boxes from `first` on, `placed` holds
+// their intervals): extend right while the next column is free for the whole
+// duration of the event.
+void expandGroup(std::vector<CalLayoutBox>& result, const std::vector<const IntervalTmp*>& placed, size_t first,
+                 const std::vector<std::vector<const IntervalTmp*>>& columns) {
+    int totalCols = (int)columns.size();
+    for (size_t i = first; i < result.size(); ++i) {
+        CalLayoutBox& box = result[i];
+        box.groupColumns = totalCols;
+        for (int next = box.column + 1; next < totalCols; ++next) {
+            if (columnOverlaps(columns[next], placed[i]->startMin, placed[i]->endMin)) break;
+            box.colSpan++;
+        }
+    }
 }
 }
 
-std::vector<CalLayoutBox> computeCalendarLayout(const std::vector<CalLayoutInput>& inputs) {
+std::vector<CalLayoutBox> computeCalendarLayout(const CalEventDay& day) {
     std::vector<IntervalTmp> intervals;
-    intervals.reserve(inputs.size());
-    for (size_t i=0;i<inputs.size();++i) {
-        String endIso = inputs[i].endIso.length() ? inputs[i].endIso : plusOneHour(inputs[i].startIso);
-        int s = parseMinutes(inputs[i].startIso);
-        int e = parseMinutes(endIso);
+    intervals.reserve(day.size());
+    for (size_t i=0;i<day.size();++i) {
+        int s = day[i].startMin;
+        int rawEnd = resolvedEnd(day[i]);
+        int e = rawEnd;
         if (e <= s) e = s + 60; // fallback 1h
-        intervals.push_back({i, s, e, inputs[i].startIso, endIso});
+        intervals.push_back({i, s, e, rawEnd});
     }
-    // Sort by start asc, duration desc
+    // Sort by start asc, duration desc; ties keep the day's order
     std::sort(intervals.begin(), intervals.end(), [](const IntervalTmp& a, const IntervalTmp& b){
         if (a.startMin != b.startMin) return a.startMin < b.startMin;
-        return (a.endMin - a.startMin) > (b.endMin - b.startMin);
+        int da = a.endMin - a.startMin, db = b.endMin - b.startMin;
+        if (da != db) return da > db;
+        return a.idx < b.idx;
     });
 
-    struct GroupInfo { std::vector<size_t> indices; int maxEnd; }; 
-    std::vector<GroupInfo> groups;
-    // Build overlap groups
-    for (size_t i=0;i<intervals.size();++i) {
-        if (groups.empty() || intervals[i].startMin >= groups.back().maxEnd) {
-            groups.push_back(GroupInfo{{i}, intervals[i].endMin});
-        } else {
-            groups.back().indices.push_back(i);
-            if (intervals[i].endMin > groups.back().maxEnd) groups.back().maxEnd = intervals[i].endMin;
-        }
-    }
-
-    std::vector<CalLayoutBox> result; result.reserve(inputs.size());
-    for (auto &g : groups) {
-        std::vector<int> colEnd;
-        struct LocalPlaced { size_t vecIdx; int col; };
-        std::vector<LocalPlaced> local;
-        for (size_t gi : g.indices) {
-            const auto &iv = intervals[gi];
-            int col = 0;
-            for (;;++col) {
-                bool clash = false;
-                for (auto &lp : local) {
-                    if (lp.col == col) {
-                        const auto &other = intervals[lp.vecIdx];
-                        bool overlap = !(iv.endMin <= other.startMin || iv.startMin >= other.endMin);
-                        if (overlap) { clash = true; break; }
-                    }
-                }
-                if (!clash) break;
-            }
-            local.push_back({gi, col});
-            if ((int)colEnd.size() <= col) colEnd.resize(col+1, 0);
-            if (iv.endMin > colEnd[col]) colEnd[col] = iv.endMin;
+    // Sweep in start order. `active` holds the running events by end, `freeCols`
+    // the columns whose last event has ended; the lowest free column is taken.
+    // An overlap group ends when no event is running any more.
+    std::priority_queue<EndColumn, std::vector<EndColumn>, std::greater<EndColumn>> active;
+    std::priority_queue<int, std::vector<int>, std::greater<int>> freeCols;
+    std::vector<std::vector<const IntervalTmp*>> columns;
+    std::vector<CalLayoutBox> result; result.reserve(day.size());
+    std::vector<const IntervalTmp*> placed; placed.reserve(day.size());
+    size_t groupFirst = 0;
+    for (const auto &iv : intervals) {
+        while (!active.empty() && active.top().first <= iv.startMin) {
+            freeCols.push(active.top().second);
+            active.pop();
         }
-        int totalCols = (int)colEnd.size();
-        // Pre-create boxes with span=1
-        for (auto &lp : local) {
-            const auto &iv = intervals[lp.vecIdx];
-            result.push_back({iv.idx, lp.col, totalCols, 1, iv.endIso});
+        if (active.empty() && !columns.empty()) {
+            expandGroup(result, placed, groupFirst, columns);
+            groupFirst = result.size();
+            columns.clear();
+            freeCols = decltype(freeCols)();
         }
-        // Compute possible expansion to right for each
-        for (auto &box : result) {
-            if (box.groupColumns != totalCols) continue; // skip boxes from earlier groups
-            // Build overlap occupancy per column for time window of this event
-            const auto &iv = intervals[ local[ box.column ].vecIdx ];
-            int startMin = iv.startMin;
-            int endMin = iv.endMin;
-            // try to extend while next column has no overlapping event in that time slice
-            for (int nextCol = box.column + 1; nextCol < totalCols; ++nextCol) {
-                bool freeCol = true;
-                for (auto &lp : local) {
-                    if (lp.col == nextCol) {
-                        const auto &other = intervals[lp.vecIdx];
-                        bool overlap = !(other.endMin <= startMin || other.startMin >= endMin);
-                        if (overlap) { freeCol = false; break; }
-                    }
-                }
-                if (freeCol) {
-                    box.colSpan++;
-                } else break;
-            }
+        int col;
+        if (freeCols.empty()) {
+            col = (int)columns.size();
+            columns.emplace_back();
+        } else {
+            col = freeCols.top();
+            freeCols.pop();
         }
+        columns[col].push_back(&iv);
+        active.push({iv.endMin, col});
+        placed.push_back(&iv);
+        result.push_back({iv.idx, col, 0, 1, iv.startMin, iv.rawEndMin});
     }
-    std::sort(result.begin(), result.end(), [&](const CalLayoutBox& a, const CalLayoutBox& b){
-        const auto &A = intervals[a.eventIndex];
-        const auto &B = intervals[b.eventIndex];
-        if (A.startMin != B.startMin) return A.startMin < B.startMin;
+    if (!columns.empty()) expandGroup(result, placed, groupFirst, columns);
+
+    // Drawing order: start, then column. Boxes are already in start order.
+    std::stable_sort(result.begin(), result.end(), [](const CalLayoutBox& a, const CalLayoutBox& b){
+        if (a.startMin != b.startMin) return a.startMin < b.startMin;
         return a.column < b.column;
     });
     return result;
@@ -1,20 +1,15 @@
 // CalLayout.h - calendar event overlap layout helper
 #pragma once
-#include <Arduino.h>
 #include <vector>
-
-// Lightweight description of an event needed for layout.
-struct CalLayoutInput {
-    String startIso; // ISO start
-    String endIso;   // ISO end (may be empty -> treated as +1h)
-};
+#include <CalEvents.h>
 
 struct CalLayoutBox {
-    size_t eventIndex;   // index into original events vector
+    size_t eventIndex;   // index into the day's events
     int column;          // assigned column within its overlap group (leftmost if spanning)
     int groupColumns;    // total columns in that overlap group
     int colSpan;          // how many columns this event spans (>=1)
-    String effectiveEnd; // resolved end ISO (with +1h fallback applied)
+    int startMin;        // start, minutes from midnight
+    int endMin;          // resolved end (without end: +1h, hour clamped to 23), may be <= startMin
 };
 
 // Compute column layout for overlapping events.
@@ -23,5 +18,9 @@ struct CalLayoutBox {
 //  * If same start, longer duration -> left.
 //  * Two parallel events -> each spans half width (groupColumns=2 used by renderer).
 //  * More than two -> equal width columns.
+//  * An event takes the leftmost column that is free at its start and spans
+//    right while the next columns are free for its whole duration.
+// Sweep over integer minutes: O(n log n) for the columns, spans cost one
+// binary search per column they cross.
 // Original simple layout (one box per event).
-std::vector<CalLayoutBox> computeCalendarLayout(const std::vector<CalLayoutInput>& inputs);
+std::vector<CalLayoutBox> computeCalendarLayout(const CalEventDay& day);
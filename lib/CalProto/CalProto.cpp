@@ -0,0 +1,97 @@
+// CalProto.cpp
+#include "CalProto.h"
+#include <string.h>
+
+namespace {
+// Reads an unsigned decimal field and advances p. Empty or overflowing fields fail.
+bool readNumber(const char*& p, const char* end, uint32_t& out) {
+    uint64_t v = 0;
+    const char* start = p;
+    while (p < end && *p >= '0' && *p <= '9') {
+        v = v * 10 + (uint32_t)(*p - '0');
+        if (v > 0xFFFFFFFFull) return false;
+        ++p;
+    }
+    if (p == start) return false;
+    out = (uint32_t)v;
+    return true;
+}
+
+bool readField(const char*& p, const char* end, uint32_t& out) {
+    if (p >= end || *p != ':') return false;
+    ++p;
+    return readNumber(p, end, out);
+}
+
+bool atLineEnd(const char* p, const char* end) {
+    while (p < end && (*p == '\r' || *p == ' ')) ++p;
+    return p == end;
+}
+
+uint32_t readLe32(const uint8_t* p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+// Half-byte table: 64 bytes instead of 1 KB, fast enough for BLE rates.
+const uint32_t CRC_NIBBLE[16] = {
+    0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+    0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C, 0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C,
+};
+}
+
+uint32_t calCrc32(const uint8_t* data, size_t len, uint32_t crc) {
+    crc = ~crc;
+    for (size_t i = 0; i < len; ++i) {
+        crc ^= data[i];
+        crc = (crc >> 4) ^ CRC_NIBBLE[crc & 0x0F];
+        crc = (crc >> 4) ^ CRC_NIBBLE[crc & 0x0F];
+    }
+    return ~crc;
+}
+
+bool calIsTransferHeader(const char* line, size_t len) {
+    return len >= 3 && memcmp(line, "LEN", 3) == 0;
+}
+
+bool calParseTransferHeader(const char* line, size_t len, CalTransferHeader& out) {
+    memset(&out, 0, sizeof(out));
+    if (!calIsTransferHeader(line, len)) return false;
+    const char* p = line + 3;
+    const char* end = line + len;
+    while (p < end && *p != ':') {
+        switch (*p) {
+            case 'F': out.force = true; break;
+            case 'Z': out.compressed = true; break;
+            case 'D': out.delta = true; break;
+            case 'B': out.bench = true; break;
+            case 'P': out.frame = true; break;
+            case 'R': out.framed = true; break;
+            default: return false;
+        }
+        ++p;
+    }
+    if (!readField(p, end, out.wireLength)) return false;
+    out.rawLength = out.wireLength;
+    if (out.compressed && !readField(p, end, out.rawLength)) return false;
+    if (out.delta && !readField(p, end, out.baseHash)) return false;
+    if (out.frame && !readField(p, end, out.eventsHash)) return false;
+    if (out.framed && !readField(p, end, out.transferId)) return false;
+    return atLineEnd(p, end);
+}
+
+bool calParseFrame(const uint8_t* buf, size_t len, uint32_t& offset, const uint8_t*& payload, size_t& payloadLen) {
+    if (len <= CAL_FRAME_OVERHEAD) return false;
+    size_t body = len - 4;
+    if (calCrc32(buf, body) != readLe32(buf + body)) return false;
+    offset = readLe32(buf);
+    payload = buf + 4;
+    payloadLen = body - 4;
+    return true;
+}
+
+bool calParseResume(const char* line, size_t len, uint32_t& transferId) {
+    if (len < 7 || memcmp(line, "RESUME", 6) != 0) return false;
+    const char* p = line + 6;
+    const char* end = line + len;
+    return readField(p, end, transferId) && atLineEnd(p, end);
+}
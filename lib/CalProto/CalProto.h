@@ -0,0 +1,54 @@
+// CalProto.h - BLE transfer protocol helpers (header parsing)
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+// Transfer header: "LEN" + option letters + ":" + fields, terminated by '\n'.
+//   LEN:<bytes>                 raw payload
+//   LENF:<bytes>                force redraw
+//   LENZ:<bytes>:<rawBytes>     zlib stream, inflated on the device to <rawBytes>
+//   LEND:<bytes>:<baseHash>     CalBin delta (upserts / deletes by id), only
+//                               applied if the stored set hash equals <baseHash>
+//   LENB:<bytes>                throughput benchmark, payload is only counted
+//   LENP:<bytes>:<eventsHash>   panel frame rendered on the host (CalRender):
+//                               792 x 272 native 2bpp rows (53856 bytes after
+//                               inflate), written to the panel as is;
+//                               <eventsHash> is CalEventDay::hash() of the day
+//   LENR:<bytes>:<transferId>   framed payload (see calParseFrame), resumable
+//                               with RESUME:<transferId> after a disconnect
+// Option letters may be combined (e.g. LENZF). Fields follow in the order
+// listed above; options without a field only set a flag.
+struct CalTransferHeader {
+    bool force;          // F
+    bool compressed;     // Z
+    bool delta;          // D
+    bool bench;          // B
+    bool frame;          // P
+    bool framed;         // R
+    uint32_t wireLength; // bytes following the header
+    uint32_t rawLength;  // bytes after inflate (== wireLength if not compressed)
+    uint32_t baseHash;   // D: set hash the delta was computed against
+    uint32_t eventsHash; // P: events shown in the frame
+    uint32_t transferId; // R: host-chosen id (CRC32 of the wire payload)
+};
+
+// Parses one header line (without the '\n'). Returns false on syntax errors
+// or unknown options.
+bool calParseTransferHeader(const char* line, size_t len, CalTransferHeader& out);
+
+// True if the line starts with the transfer header prefix "LEN".
+bool calIsTransferHeader(const char* line, size_t len);
+
+// Framed chunk: u32 offset | payload | u32 CRC32(offset bytes + payload),
+// little endian. Offsets count payload bytes after the header.
+static const size_t CAL_FRAME_OVERHEAD = 8;
+
+// Validates a framed chunk. Returns false if it is too short or the CRC does
+// not match; `payload` then points into `buf`.
+bool calParseFrame(const uint8_t* buf, size_t len, uint32_t& offset, const uint8_t*& payload, size_t& payloadLen);
+
+// Parses "RESUME:<transferId>" (without the '\n').
+bool calParseResume(const char* line, size_t len, uint32_t& transferId);
+
+// CRC-32 as used by zlib (poly 0xEDB88320); chainable via `crc`.
+uint32_t calCrc32(const uint8_t* data, size_t len, uint32_t crc = 0);
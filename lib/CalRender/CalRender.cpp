@@ -0,0 +1,193 @@
+// CalRender.cpp
+#include "CalRender.h"
+#include <stdio.h>
+#include <GxEPD2.h> // colors (GxEPD_BLACK, ...)
+#include <Fonts/FreeSansBold12pt7b.h>
+#include <Fonts/FreeSansBold7pt7b.h>
+#include <Fonts/FreeSans7pt7b.h>
+#include <Fonts/FreeSans6pt7b.h>
+#include <Fonts/Font5x7Fixed.h>
+#include <Fonts/Font4x5Fixed.h>
+#include <Icons.h>
+#include <CalBin.h>
+#include <CalText.h>
+
+namespace {
+const int HEADER_HEIGHT = 56;
+
+// Day, date and battery level on the header bar of calRenderBackground()
+void drawHeader(Adafruit_GFX& gfx, const CalRenderInfo& info) {
+    gfx.setTextColor(GxEPD_WHITE);
+    gfx.setFont(&FreeSansBold12pt7b);
+    gfx.setCursor(10, 22); gfx.print(info.weekday);
+    gfx.setCursor(10, 46); gfx.print(info.date);
+    gfx.fillRect(270 - 18 + 2, 8, info.battery, 5, GxEPD_WHITE);
+    gfx.setTextColor(GxEPD_BLACK);
+}
+}
+
+void calRenderDateHeader(const struct tm& t, char* weekday, size_t weekdayLen, char* date, size_t dateLen) {
+    static const char* WEEKDAY_DE[7] = {"Sonntag", "Montag", "Dienstag", "Mittwoch", "Donnerstag", "Freitag", "Samstag"};
+    static const char* MONTH_DE[12] = {"Januar", "Februar", "März", "April", "Mai", "Juni", "Juli", "August", "September", "Oktober", "November", "Dezember"};
+    int w = t.tm_wday;
+    if (w < 0 || w > 6) w = 0;
+    int m = t.tm_mon;
+    if (m < 0 || m > 11) m = 0;
+    snprintf(weekday, weekdayLen, "%s", WEEKDAY_DE[w]);
+    snprintf(date, dateLen, "%d. %s", t.tm_mday, MONTH_DE[m]);
+}
+
+void calRenderBackground(Adafruit_GFX& gfx) {
+    gfx.fillScreen(GxEPD_WHITE);
+    gfx.fillRect(0, 0, gfx.width(), HEADER_HEIGHT, GxEPD_RED);
+    // Status icons (the battery is filled by drawHeader)
+    gfx.drawBitmap(270 - 18, 6, epd_bitmap_batt, 16, 9, GxEPD_WHITE);
+    gfx.drawBitmap(270 - 18 - 16, 3, epd_bitmap_bt, 11, 12, GxEPD_WHITE);
+    drawTimelineAxis(gfx);
+}
+
+EpdRect calRenderFrame(Adafruit_GFX& gfx, const CalRenderInfo& info, const CalEventDay& events,
+                       const std::vector<CalLayoutBox>& boxes) {
+    if (!info.background) {
+        calRenderBackground(gfx);
+        if (info.stage) info.stage("background", info.stageCtx);
+    }
+    drawHeader(gfx, info);
+    if (info.stage) info.stage("header", info.stageCtx);
+    drawEvents(gfx, events, boxes);
+    if (info.stage) info.stage("events", info.stageCtx);
+    EpdRect stamp = drawUpdateTimestamp(gfx, info.stamp);
+    if (info.stage) info.stage("stamp", info.stageCtx);
+    return stamp;
+}
+
+void drawTimelineAxis(Adafruit_GFX& gfx) {
+    gfx.setTextColor(GxEPD_BLACK);
+    for (int h = TIMELINE_START_HOUR; h <= TIMELINE_END_HOUR; h++) {
+        int y = TIMELINE_Y_START + (int)((h - TIMELINE_START_HOUR) * PX_PER_HOUR);
+        gfx.setFont(&FreeSans6pt7b);
+        gfx.setCursor(0, y + 5);
+        char buf[6];
+        snprintf(buf, sizeof(buf), "%02d", h);
+        gfx.print(buf);
+        gfx.drawLine(17, y, gfx.width(), y, GxEPD_DARKGREY);
+    }
+}
+
+int drawWrapped(Adafruit_GFX& gfx, int x, int y, int w, const GFXfont* font, const char* text, int maxLines, int lineAdvance) {
+    CalTextLine lines[4];
+    size_t cap = sizeof(lines) / sizeof(lines[0]);
+    size_t n = calTextWrap(font, text, w, lines, (size_t)maxLines < cap ? (size_t)maxLines : cap);
+    gfx.setFont(font);
+    for (size_t i = 0; i < n; i++) {
+        gfx.setCursor(x, y);
+        gfx.write((const uint8_t*)text + lines[i].start, lines[i].length);
+        if (lines[i].ellipsis) gfx.print(CALTEXT_ELLIPSIS);
+        y += lineAdvance;
+    }
+    return y;
+}
+
+int minutesToY(int minutesFromMidnight) {
+    int hour = minutesFromMidnight / 60;
+    int min = minutesFromMidnight % 60;
+    float rel = ((hour - TIMELINE_START_HOUR) + min / 60.0f);
+    return TIMELINE_Y_START + (int)(rel * PX_PER_HOUR);
+}
+
+// Does not depend on the box height (drawEvents draws the Teams icon at the foot).
+int drawEventContent(Adafruit_GFX& gfx, int x, int y, int boxW, int totalW, const CalEventDay& events, size_t index) {
+    const CalEvent& evt = events[index];
+    gfx.setTextColor(GxEPD_BLACK);
+    const GFXfont* titleFont = (evt.flags & CALBIN_CANCELLED) ? &FreeSans7pt7b : &FreeSansBold7pt7b;
+    int textLeft = x + 4;
+    int textWidth = totalW - 8;
+    int cursorY = y + 12;
+    cursorY = drawWrapped(gfx, textLeft, cursorY, textWidth, titleFont, events.str(evt.titleOff), 2, 14);
+    cursorY = drawWrapped(gfx, textLeft, cursorY, textWidth, &Font5x7Fixed, events.str(evt.organizerOff), 1, 12);
+    cursorY = drawWrapped(gfx, textLeft, cursorY, textWidth, &Font5x7Fixed, events.str(evt.locationOff), 1, 12);
+
+    int iconX = x + boxW - 14;
+    if (evt.flags & CALBIN_RECURRING) {
+        if (evt.flags & CALBIN_MOVED)
+            gfx.drawBitmap(iconX, y + 1, epd_bitmap_series_mov, 13, 12, GxEPD_BLACK);
+        else
+            gfx.drawBitmap(iconX, y + 1, epd_bitmap_series, 12, 12, GxEPD_BLACK);
+    }
+    if (evt.flags & CALBIN_ATTACHMENTS)
+        gfx.drawBitmap(iconX - 10, y + 2, epd_bitmap_attachment, 10, 12, GxEPD_BLACK);
+    if (evt.flags & CALBIN_IMPORTANT)
+        gfx.drawBitmap(x + 1, y + 5, epd_bitmap_important, 6, 11, GxEPD_RED);
+    return cursorY;
+}
+
+void drawEvents(Adafruit_GFX& gfx, const CalEventDay& events, const std::vector<CalLayoutBox>& boxes) {
+    gfx.setFont(&FreeSansBold7pt7b);
+    gfx.setTextColor(GxEPD_BLACK);
+
+    if (events.empty()) {
+        gfx.setCursor(50, TIMELINE_Y_START + 20);
+        gfx.print("Keine Termine heute.");
+        return;
+    }
+    const int xBase = 20;
+    const int innerWidth = 248;
+    const int gap = 4;
+    for (auto& box : boxes) {
+        const CalEvent& evt = events[box.eventIndex];
+        int yStart = minutesToY(box.startMin);
+        int yEnd = minutesToY(box.endMin);
+        if (yEnd <= yStart)
+            yEnd = yStart + 22;
+        int box_w;
+        if (box.groupColumns == 2) box_w = (innerWidth - gap) / 2; else box_w = (innerWidth - gap * (box.groupColumns - 1)) / box.groupColumns;
+        int span = box.colSpan > 1 ? box.colSpan : 1;
+        int box_x = xBase + box.column * (box_w + gap);
+        int box_total_w = box_w * span + gap * (span - 1);
+        int box_y = yStart + 1;
+        int box_h = yEnd - yStart - 2 > 22 ? yEnd - yStart - 2 : 22;
+
+        // Cancelled style: white fill, yellow border; else yellow fill
+        if (evt.flags & CALBIN_CANCELLED) {
+            gfx.fillRect(box_x, box_y, box_total_w, box_h, GxEPD_WHITE);
+            gfx.drawRect(box_x, box_y, box_total_w, box_h, GxEPD_YELLOW);
+        } else {
+            gfx.fillRect(box_x, box_y, box_total_w, box_h, GxEPD_YELLOW);
+        }
+
+        drawEventContent(gfx, box_x, box_y, box_w, box_total_w, events, box.eventIndex);
+        if (evt.flags & CALBIN_ONLINE)
+            gfx.drawBitmap(box_x + box_w - 14, box_y + box_h - 12, epd_bitmap_Teams, 12, 12, GxEPD_BLACK);
+    }
+}
+
+// Update time at the bottom right in the 4x5 fixed font
+EpdRect drawUpdateTimestamp(Adafruit_GFX& gfx, const char* stamp) {
+    if (!stamp || !stamp[0])
+        return {0, 0, 0, 0};
+    gfx.setFont(&Font4x5Fixed);
+    int16_t x1, y1;
+    uint16_t w, h;
+    gfx.getTextBounds(stamp, 0, 0, &x1, &y1, &w, &h);
+    int x = gfx.width() - w - 4;
+    int y = gfx.height() - 4; // baseline near bottom
+    gfx.setTextColor(GxEPD_DARKGREY);
+    gfx.setCursor(x, y);
+    gfx.print(stamp);
+    return {(int16_t)(x + x1), (int16_t)(y + y1), (int16_t)w, (int16_t)h};
+}
+
+int battLvl(int Vbattf) {
+    if (Vbattf > 4.2) return 11;
+    if (Vbattf > 4.1) return 10;
+    if (Vbattf > 4) return 9;
+    if (Vbattf > 3.95) return 8;
+    if (Vbattf > 3.90) return 7;
+    if (Vbattf > 3.80) return 6;
+    if (Vbattf > 3.70) return 5;
+    if (Vbattf > 3.60) return 4;
+    if (Vbattf > 3.50) return 3;
+    if (Vbattf > 3.40) return 2;
+    if (Vbattf > 3.30) return 1;
+    return 0;
+}
@@ -0,0 +1,76 @@
+// CalRender.h - the calendar frame (header, timeline, event boxes) on any Adafruit_GFX target
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+#include <vector>
+#include <Adafruit_GFX.h>
+#include <CalBand.h>
+#include <CalEvents.h>
+#include <CalLayout.h>
+
+// Shared by the firmware (display buffer or display list) and the host
+// renderer in tools/render, so both produce the same pixels. Coordinates are
+// screen coordinates after setRotation(1): 272 x 792, portrait.
+
+// Timeline
+const int TIMELINE_START_HOUR = 8;
+const int TIMELINE_END_HOUR = 18;
+const int TIMELINE_Y_START = 65;
+const int TIMELINE_Y_END = 780;
+const int TIMELINE_HEIGHT = TIMELINE_Y_END - TIMELINE_Y_START;
+const int TIMELINE_HOURS = TIMELINE_END_HOUR - TIMELINE_START_HOUR;
+const float PX_PER_HOUR = (float)TIMELINE_HEIGHT / TIMELINE_HOURS;
+
+// Screen rectangle
+struct EpdRect { int16_t x, y, w, h; };
+
+// Called after each stage of calRenderFrame ("background", "header", "events", "stamp").
+typedef void (*CalRenderStageFn)(const char* stage, void* ctx);
+
+struct CalRenderInfo {
+    const char* weekday;          // header lines, see calRenderDateHeader ("" = none)
+    const char* date;
+    int battery;                  // filled width of the battery icon, see battLvl
+    const char* stamp;            // update time "HH:MM" at the bottom right ("" = none)
+    CalRenderStageFn stage;       // optional
+    void* stageCtx;
+    bool background;              // static layer already in the target (CAL_BACKGROUND)
+};
+
+// German weekday and "<day>. <month>" for the header.
+void calRenderDateHeader(const struct tm& t, char* weekday, size_t weekdayLen, char* date, size_t dateLen);
+
+// The static layer: white page, header bar with the status icons, hour labels
+// and grid lines. Everything else is drawn on top of it and never under it, so
+// a copy of this layer can replace the drawing.
+void calRenderBackground(Adafruit_GFX& gfx);
+// calRenderBackground() rendered for rotation 1 in panel-native rows, generated
+// by tools/render (`calrender --background lib/CalRender/CalBackground.cpp`).
+// Regenerate after changing calRenderBackground(); calrender reports a mismatch.
+extern const CalRowImage CAL_BACKGROUND;
+
+// The whole frame: static layer (unless info.background), header texts and
+// battery level, events, timestamp.
+// Boxes come from computeCalendarLayout() or the day cache.
+// Returns the area of the timestamp (w = 0 if none).
+EpdRect calRenderFrame(Adafruit_GFX& gfx, const CalRenderInfo& info, const CalEventDay& events,
+                       const std::vector<CalLayoutBox>& boxes);
+
+// Building blocks of calRenderFrame.
+void drawTimelineAxis(Adafruit_GFX& gfx);
+void drawEvents(Adafruit_GFX& gfx, const CalEventDay& events, const std::vector<CalLayoutBox>& boxes);
+// Content of one event box (text and top icons, no background) with the box's
+// top left corner at (x, y); `boxW` is the width of one column, `totalW` the
+// spanned width. Returns the bottom of the text.
+int drawEventContent(Adafruit_GFX& gfx, int x, int y, int boxW, int totalW, const CalEventDay& events, size_t index);
+EpdRect drawUpdateTimestamp(Adafruit_GFX& gfx, const char* stamp);
+
+// Wraps `text` by the glyph advances of `font` (CalText, one pass, no
+// getTextBounds); if it does not fit into maxLines, the last line ends with
+// "...". Returns y after the last line.
+int drawWrapped(Adafruit_GFX& gfx, int x, int y, int w, const GFXfont* font, const char* text, int maxLines, int lineAdvance);
+// Minutes from midnight -> y on the timeline
+int minutesToY(int minutesFromMidnight);
+// Battery voltage -> filled width of the battery icon (0..11)
+int battLvl(int Vbattf);
@@ -0,0 +1,69 @@
+// CalRing.cpp
+#include "CalRing.h"
+#include <string.h>
+
+namespace {
+const size_t LEN_PREFIX = 2;      // u16 record length, little endian
+const uint16_t WRAP_MARK = 0xFFFF; // length prefix of the padding before a wrap
+}
+
+bool CalRing::begin(uint8_t* storage, size_t capacity) {
+    if (!storage || capacity < 2 * (CALRING_MAX_RECORD + LEN_PREFIX) || (capacity & (capacity - 1))) return false;
+    _buf = storage;
+    _cap = capacity;
+    _peeked = 0;
+    _head.store(0, std::memory_order_relaxed);
+    _tail.store(0, std::memory_order_release);
+    return true;
+}
+
+bool CalRing::push(const uint8_t* data, size_t len) {
+    if (!_buf || len == 0 || len > CALRING_MAX_RECORD) return false;
+    size_t head = _head.load(std::memory_order_relaxed);
+    size_t tail = _tail.load(std::memory_order_acquire);
+    size_t at = head & (_cap - 1);
+    size_t need = LEN_PREFIX + len;
+    // Record would cross the end: pad the rest of the storage and start at 0
+    size_t pad = _cap - at < need ? _cap - at : 0;
+    if (_cap - (head - tail) < pad + need) return false;
+    if (pad) {
+        if (pad >= LEN_PREFIX) { _buf[at] = (uint8_t)WRAP_MARK; _buf[at + 1] = (uint8_t)(WRAP_MARK >> 8); }
+        at = 0;
+    }
+    _buf[at] = (uint8_t)len;
+    _buf[at + 1] = (uint8_t)(len >> 8);
+    memcpy(_buf + at + LEN_PREFIX, data, len);
+    _head.store(head + pad + need, std::memory_order_release);
+    return true;
+}
+
+const uint8_t* CalRing::peek(size_t& len) {
+    size_t tail = _tail.load(std::memory_order_relaxed);
+    size_t head = _head.load(std::memory_order_acquire);
+    if (head == tail) return nullptr;
+    size_t at = tail & (_cap - 1);
+    size_t rest = _cap - at;
+    // Padding is published together with the record behind it, so that record is there
+    if (rest < LEN_PREFIX || (_buf[at] | (_buf[at + 1] << 8)) == WRAP_MARK) {
+        tail += rest;
+        at = 0;
+    }
+    len = _buf[at] | ((size_t)_buf[at + 1] << 8);
+    _peeked = (tail - _tail.load(std::memory_order_relaxed)) + LEN_PREFIX + len;
+    return _buf + at + LEN_PREFIX;
+}
+
+void CalRing::release() {
+    if (!_peeked) return;
+    _tail.store(_tail.load(std::memory_order_relaxed) + _peeked, std::memory_order_release);
+    _peeked = 0;
+}
+
+size_t CalRing::pop(uint8_t* out) {
+    size_t len;
+    const uint8_t* rec = peek(len);
+    if (!rec) return 0;
+    memcpy(out, rec, len);
+    release();
+    return len;
+}
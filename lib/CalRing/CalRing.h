@@ -0,0 +1,41 @@
+// CalRing.h - lock-free single-producer/single-consumer ring for BLE writes
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+
+// Largest record accepted by push() (ATT attribute values are limited to 512 bytes).
+static const size_t CALRING_MAX_RECORD = 512;
+
+// Byte ring holding length-prefixed records, so every BLE write reaches the
+// consumer as one unit. Records are never split at the end of the storage
+// (the producer pads and wraps instead), so the consumer can read them in
+// place. Exactly one thread may call push() and exactly one other thread
+// peek()/release()/pop(); no locks are taken on either side.
+class CalRing {
+public:
+    // `storage` must stay valid; `capacity` must be a power of two.
+    bool begin(uint8_t* storage, size_t capacity);
+    // Producer: copies one record. Returns false (and writes nothing) if the
+    // record is empty, too large or does not fit.
+    bool push(const uint8_t* data, size_t len);
+    // Consumer: returns the oldest record in place (or nullptr if the ring is
+    // empty). The bytes stay valid until release() is called.
+    const uint8_t* peek(size_t& len);
+    // Consumer: drops the record returned by the last peek().
+    void release();
+    // Consumer: copies the oldest record into `out` (at least CALRING_MAX_RECORD
+    // bytes) and returns its length, or 0 if the ring is empty.
+    size_t pop(uint8_t* out);
+    bool empty() const { return _head.load(std::memory_order_acquire) == _tail.load(std::memory_order_relaxed); }
+    // Bytes in use (approximate while the other side is active).
+    size_t used() const { return _head.load(std::memory_order_acquire) - _tail.load(std::memory_order_acquire); }
+    size_t capacity() const { return _cap; }
+
+private:
+    uint8_t* _buf = nullptr;
+    size_t _cap = 0;
+    std::atomic<size_t> _head{0}; // written by the producer only
+    std::atomic<size_t> _tail{0}; // written by the consumer only
+    size_t _peeked = 0;           // consumer: bytes of the record handed out by peek()
+};
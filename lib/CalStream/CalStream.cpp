@@ -0,0 +1,324 @@
+// CalStream.cpp
+#include "CalStream.h"
+#include <string.h>
+
+namespace {
+enum Field : uint8_t {
+    F_NONE, F_ID, F_START, F_END, F_SUMMARY, F_SUBJECT, F_LOCATION, F_ORGANIZER,
+    F_IMPORTANCE, F_ONLINE, F_RECURRING, F_MOVED, F_ATTACHMENTS, F_CANCELLED
+};
+
+const uint32_t FNV_OFFSET = 2166136261u;
+const uint32_t FNV_PRIME = 16777619u;
+
+constexpr uint32_t keyHash(const char* s, uint32_t h = FNV_OFFSET) {
+    return *s ? keyHash(s + 1, (h ^ (uint8_t)*s) * FNV_PRIME) : h;
+}
+
+// Key table, resolved at compile time (duplicate hashes would not compile).
+uint8_t fieldForKey(uint32_t h) {
+    switch (h) {
+        case keyHash("id"):              return F_ID;
+        case keyHash("start"):           return F_START;
+        case keyHash("end"):             return F_END;
+        case keyHash("summary"):         return F_SUMMARY;
+        case keyHash("subject"):         return F_SUBJECT;
+        case keyHash("location"):        return F_LOCATION;
+        case keyHash("organizer"):       return F_ORGANIZER;
+        case keyHash("importance"):      return F_IMPORTANCE;
+        case keyHash("isOnlineMeeting"): return F_ONLINE;
+        case keyHash("isRecurring"):     return F_RECURRING;
+        case keyHash("isMoved"):         return F_MOVED;
+        case keyHash("hasAttachments"):  return F_ATTACHMENTS;
+        case keyHash("isCancelled"):     return F_CANCELLED;
+        default:                         return F_NONE;
+    }
+}
+
+inline bool isWs(char c) { return c == ' ' || c == '\n' || c == '\r' || c == '\t'; }
+
+int hexVal(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+// Drop an incomplete UTF-8 sequence at the end of a truncated buffer.
+size_t trimUtf8(const char* s, size_t len) {
+    size_t i = len;
+    int cont = 0;
+    while (i > 0 && cont < 3 && ((uint8_t)s[i - 1] & 0xC0) == 0x80) { --i; ++cont; }
+    if (i == 0) return len;
+    uint8_t lead = (uint8_t)s[i - 1];
+    int need = (lead & 0xE0) == 0xC0 ? 1 : (lead & 0xF0) == 0xE0 ? 2 : (lead & 0xF8) == 0xF0 ? 3 : 0;
+    if (lead >= 0x80 && cont < need) return i - 1;
+    return len;
+}
+}
+
+void CalStream::begin(CalStreamSink sink, void* ctx) {
+    _sink = sink;
+    _ctx = ctx;
+    _events = 0;
+    _state = EXPECT_ARRAY;
+    _dst = nullptr;
+    _escape = 0;
+    _uHigh = 0;
+    _depth = 0;
+}
+
+void CalStream::beginObject() {
+    memset(&_evt, 0, sizeof(_evt));
+    _haveSummary = false;
+}
+
+void CalStream::emitObject() {
+    _evt.hasStartTime = calTimeParse(_evt.start, _evt.startTime);
+    _evt.hasEndTime = calTimeParse(_evt.end, _evt.endTime);
+    ++_events;
+    if (_sink) _sink(_evt, _ctx);
+}
+
+void CalStream::beginString() {
+    _dst = nullptr;
+    _dstCap = 0;
+    switch (_field) {
+        case F_START:     _dst = _evt.start;     _dstCap = sizeof(_evt.start); break;
+        case F_END:       _dst = _evt.end;       _dstCap = sizeof(_evt.end); break;
+        case F_SUMMARY:   _dst = _evt.title;     _dstCap = sizeof(_evt.title); break;
+        case F_SUBJECT:
+            if (!_haveSummary) { _dst = _evt.title; _dstCap = sizeof(_evt.title); }
+            break;
+        case F_LOCATION:  _dst = _evt.location;  _dstCap = sizeof(_evt.location); break;
+        case F_ORGANIZER: _dst = _evt.organizer; _dstCap = sizeof(_evt.organizer); break;
+        case F_IMPORTANCE:
+        case F_ID:        _dst = _lit;           _dstCap = sizeof(_lit); break;
+        default: break;
+    }
+    _dstLen = 0;
+    _truncated = false;
+    _escape = 0;
+    _uHigh = 0;
+}
+
+void CalStream::putChar(char c) {
+    if (!_dst) return;
+    if (_dstLen + 1 < _dstCap) _dst[_dstLen++] = c;
+    else _truncated = true;
+}
+
+void CalStream::putCodepoint(uint32_t cp) {
+    if (cp < 0x80) {
+        putChar((char)cp);
+    } else if (cp < 0x800) {
+        putChar((char)(0xC0 | (cp >> 6)));
+        putChar((char)(0x80 | (cp & 0x3F)));
+    } else if (cp < 0x10000) {
+        putChar((char)(0xE0 | (cp >> 12)));
+        putChar((char)(0x80 | ((cp >> 6) & 0x3F)));
+        putChar((char)(0x80 | (cp & 0x3F)));
+    } else {
+        putChar((char)(0xF0 | (cp >> 18)));
+        putChar((char)(0x80 | ((cp >> 12) & 0x3F)));
+        putChar((char)(0x80 | ((cp >> 6) & 0x3F)));
+        putChar((char)(0x80 | (cp & 0x3F)));
+    }
+}
+
+void CalStream::endString() {
+    if (!_dst) return;
+    if (_truncated) _dstLen = trimUtf8(_dst, _dstLen);
+    _dst[_dstLen] = '\0';
+    switch (_field) {
+        case F_SUMMARY: _evt.hasTitle = true; _haveSummary = true; break;
+        case F_SUBJECT: _evt.hasTitle = true; break;
+        case F_IMPORTANCE: _evt.isImportant = strcmp(_lit, "high") == 0; break;
+        case F_ID: {
+            uint32_t v = 0;
+            size_t i = 0;
+            for (; i < _dstLen && i < 8; ++i) {
+                int d = hexVal(_lit[i]);
+                if (d < 0) break;
+                v = (v << 4) | (uint32_t)d;
+            }
+            _evt.hasId = (i == _dstLen && i > 0);
+            _evt.id = _evt.hasId ? v : 0;
+            break;
+        }
+        default: break;
+    }
+    _dst = nullptr;
+}
+
+void CalStream::endLiteral() {
+    _lit[_litLen] = '\0';
+    bool value;
+    if (strcmp(_lit, "true") == 0) value = true;
+    else if (strcmp(_lit, "false") == 0 || strcmp(_lit, "null") == 0) value = false;
+    else { _state = FAILED; return; }
+    switch (_field) {
+        case F_ONLINE:      _evt.isOnlineMeeting = value; break;
+        case F_RECURRING:   _evt.isRecurring = value; break;
+        case F_MOVED:       _evt.isMoved = value; break;
+        case F_ATTACHMENTS: _evt.hasAttachments = value; break;
+        case F_CANCELLED:   _evt.isCanceled = value; break;
+        default: break; // null for string fields keeps them empty
+    }
+}
+
+bool CalStream::step(char c) {
+    switch (_state) {
+    case EXPECT_ARRAY:
+        if (isWs(c)) return true;
+        if (c == '[') { _state = EXPECT_OBJECT; return true; }
+        return false;
+
+    case EXPECT_OBJECT:
+        if (isWs(c)) return true;
+        if (c == '{') { beginObject(); _state = EXPECT_KEY; return true; }
+        if (c == ']') { _state = DONE; return true; }
+        return false;
+
+    case EXPECT_KEY:
+        if (isWs(c)) return true;
+        if (c == '"') { _keyHash = FNV_OFFSET; _keyEscape = false; _state = IN_KEY; return true; }
+        if (c == '}') { emitObject(); _state = AFTER_OBJECT; return true; }
+        return false;
+
+    case IN_KEY:
+        if (!_keyEscape && c == '"') { _field = fieldForKey(_keyHash); _state = EXPECT_COLON; return true; }
+        if (!_keyEscape && c == '\\') { _keyEscape = true; return true; }
+        _keyEscape = false;
+        _keyHash = (_keyHash ^ (uint8_t)c) * FNV_PRIME;
+        return true;
+
+    case EXPECT_COLON:
+        if (isWs(c)) return true;
+        if (c == ':') { _state = EXPECT_VALUE; return true; }
+        return false;
+
+    case EXPECT_VALUE:
+        if (isWs(c)) return true;
+        if (c == '"') { beginString(); _state = IN_STRING; return true; }
+        if (c == '{' || c == '[') {
+            _depth = 1; _nestedString = false; _nestedEscape = false;
+            _state = IN_NESTED;
+            return true;
+        }
+        if (c == 't' || c == 'f' || c == 'n') { _lit[0] = c; _litLen = 1; _state = IN_LITERAL; return true; }
+        if (c == '-' || (c >= '0' && c <= '9')) { _state = IN_NUMBER; return true; }
+        return false;
+
+    case IN_STRING:
+        if (_escape == 1) {
+            _escape = 0;
+            switch (c) {
+                // Decoded as-is like ArduinoJson, cal.py and CalBin, so the event hashes
+                // match; CalText and Adafruit_GFX give control characters no width
+                case 'n': putChar('\n'); break;
+                case 't': putChar('\t'); break;
+                case 'r': putChar('\r'); break;
+                case 'b': putChar('\b'); break;
+                case 'f': putChar('\f'); break;
+                case 'u': _escape = 2; _uAcc = 0; break;
+                default: putChar(c); break; // \" \\ \/
+            }
+            return true;
+        }
+        if (_escape >= 2) {
+            int v = hexVal(c);
+            if (v < 0) return false;
+            _uAcc = (uint16_t)((_uAcc << 4) | v);
+            if (++_escape < 6) return true;
+            _escape = 0;
+            if (_uAcc >= 0xD800 && _uAcc <= 0xDBFF) { _uHigh = _uAcc; return true; }
+            if (_uAcc >= 0xDC00 && _uAcc <= 0xDFFF) {
+                if (_uHigh) putCodepoint(0x10000u + (((uint32_t)_uHigh - 0xD800u) << 10) + (_uAcc - 0xDC00u));
+                _uHigh = 0;
+                return true;
+            }
+            _uHigh = 0;
+            putCodepoint(_uAcc);
+            return true;
+        }
+        if (c == '\\') { _escape = 1; return true; }
+        _uHigh = 0;
+        if (c == '"') { endString(); _state = AFTER_VALUE; return true; }
+        putChar(c);
+        return true;
+
+    case IN_LITERAL:
+        if (c >= 'a' && c <= 'z') {
+            if (_litLen >= 5) return false;
+            _lit[_litLen++] = c;
+            return true;
+        }
+        endLiteral();
+        if (_state == FAILED) return false;
+        _state = AFTER_VALUE;
+        return step(c);
+
+    case IN_NUMBER:
+        if ((c >= '0' && c <= '9') || c == '.' || c == 'e' || c == 'E' || c == '+' || c == '-') return true;
+        _state = AFTER_VALUE;
+        return step(c);
+
+    case IN_NESTED:
+        if (_nestedString) {
+            if (_nestedEscape) _nestedEscape = false;
+            else if (c == '\\') _nestedEscape = true;
+            else if (c == '"') _nestedString = false;
+            return true;
+        }
+        if (c == '"') _nestedString = true;
+        else if (c == '{' || c == '[') ++_depth;
+        else if ((c == '}' || c == ']') && --_depth == 0) _state = AFTER_VALUE;
+        return true;
+
+    case AFTER_VALUE:
+        if (isWs(c)) return true;
+        if (c == ',') { _state = EXPECT_KEY; return true; }
+        if (c == '}') { emitObject(); _state = AFTER_OBJECT; return true; }
+        return false;
+
+    case AFTER_OBJECT:
+        if (isWs(c)) return true;
+        if (c == ',') { _state = EXPECT_OBJECT; return true; }
+        if (c == ']') { _state = DONE; return true; }
+        return false;
+
+    case DONE:
+        return isWs(c);
+
+    case FAILED:
+    default:
+        return false;
+    }
+}
+
+bool CalStream::feed(const char* data, size_t len) {
+    if (_state == FAILED) return false;
+    size_t i = 0;
+    while (i < len) {
+        // Fast path: copy plain string runs without going through the state machine.
+        if (_state == IN_STRING && _escape == 0) {
+            size_t run = i;
+            while (run < len && data[run] != '"' && data[run] != '\\') ++run;
+            if (run > i) {
+                if (_dst) {
+                    size_t room = _dstCap - 1 - _dstLen;
+                    size_t n = run - i;
+                    if (n > room) { n = room; _truncated = true; }
+                    memcpy(_dst + _dstLen, data + i, n);
+                    _dstLen += n;
+                }
+                _uHigh = 0;
+                i = run;
+                continue;
+            }
+        }
+        if (!step(data[i++])) { _state = FAILED; return false; }
+    }
+    return true;
+}
@@ -0,0 +1,91 @@
+// CalStream.h - incremental parser for the condensed calendar JSON
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <CalTime.h>
+
+// Field capacities (including terminator). Longer values are truncated.
+static const size_t CALSTREAM_ISO_LEN       = 26;
+static const size_t CALSTREAM_TITLE_LEN     = 96;
+static const size_t CALSTREAM_LOCATION_LEN  = 64;
+static const size_t CALSTREAM_ORGANIZER_LEN = 48;
+
+// One event of the condensed schema, reduced to the fields that are displayed.
+struct CalStreamEvent {
+    char start[CALSTREAM_ISO_LEN];
+    char end[CALSTREAM_ISO_LEN];
+    char title[CALSTREAM_TITLE_LEN];
+    char location[CALSTREAM_LOCATION_LEN];
+    char organizer[CALSTREAM_ORGANIZER_LEN];
+    CalTime startTime;    // start/end resolved once per event (valid if hasStartTime / hasEndTime)
+    CalTime endTime;
+    bool hasStartTime;
+    bool hasEndTime;
+    uint32_t id;          // "id" (8 hex digits), stable across uploads
+    bool hasId;
+    bool hasTitle;        // "summary" or "subject" was a string
+    bool isImportant;     // "importance" == "high"
+    bool isOnlineMeeting;
+    bool isRecurring;
+    bool isMoved;
+    bool hasAttachments;
+    bool isCanceled;      // "isCancelled"
+};
+
+// Called once per completed top-level object.
+typedef void (*CalStreamSink)(const CalStreamEvent& evt, void* ctx);
+
+// Push parser for `[ {..}, {..} ]`. Input may be split at any byte boundary;
+// state is constant size, so memory use does not depend on the payload length.
+// Unknown keys and nested values (e.g. "numOf") are skipped.
+class CalStream {
+public:
+    void begin(CalStreamSink sink, void* ctx);
+    // Returns false once the input is malformed (further input is ignored).
+    bool feed(const char* data, size_t len);
+    // True if the top-level array was closed and no error occurred.
+    bool finish() const { return _state == DONE; }
+    bool failed() const { return _state == FAILED; }
+    size_t eventCount() const { return _events; }
+
+private:
+    enum State : uint8_t {
+        EXPECT_ARRAY, EXPECT_OBJECT, EXPECT_KEY, IN_KEY, EXPECT_COLON, EXPECT_VALUE,
+        IN_STRING, IN_LITERAL, IN_NUMBER, IN_NESTED, AFTER_VALUE, AFTER_OBJECT, DONE, FAILED
+    };
+
+    bool step(char c);
+    void beginObject();
+    void beginString();
+    void putChar(char c);
+    void putCodepoint(uint32_t cp);
+    void endString();
+    void endLiteral();
+    void emitObject();
+
+    CalStreamSink _sink = nullptr;
+    void* _ctx = nullptr;
+    CalStreamEvent _evt;
+    size_t _events = 0;
+
+    State _state = EXPECT_ARRAY;
+    uint8_t _field = 0;      // field of the current key (see CalStream.cpp)
+    uint32_t _keyHash = 0;   // FNV-1a over the key, matched against a constexpr table
+    bool _keyEscape = false;
+
+    char* _dst = nullptr;    // target buffer of the current string value
+    size_t _dstCap = 0;
+    size_t _dstLen = 0;
+    uint8_t _escape = 0;     // 0 = none, 1 = after '\\', 2..5 = \uXXXX digits
+    uint16_t _uAcc = 0;
+    uint16_t _uHigh = 0;     // pending high surrogate
+
+    bool _haveSummary = false; // "summary" wins over "subject"
+    bool _truncated = false;
+    char _lit[12];           // true / false / null, also holds "importance" and "id"
+    uint8_t _litLen = 0;
+
+    uint16_t _depth = 0;     // nesting depth while skipping values
+    bool _nestedString = false;
+    bool _nestedEscape = false;
+};
@@ -0,0 +1,48 @@
+// CalText.cpp
+#include "CalText.h"
+
+int calTextAdvance(const GFXfont* font, char c) {
+    uint8_t ch = (uint8_t)c;
+    if (ch < font->first || ch > font->last) return 0;
+    return font->glyph[ch - font->first].xAdvance;
+}
+
+int calTextWidth(const GFXfont* font, const char* text, size_t len) {
+    int w = 0;
+    for (size_t i = 0; i < len; ++i) w += calTextAdvance(font, text[i]);
+    return w;
+}
+
+size_t calTextWrap(const GFXfont* font, const char* text, int width, CalTextLine* lines, size_t maxLines) {
+    size_t count = 0, pos = 0;
+    while (text[pos] && count < maxLines) {
+        size_t start = pos, brk = 0, i = start;
+        int used = 0; // width of text[start, i)
+        for (; text[i] && text[i] != '\n'; ++i) {
+            int adv = calTextAdvance(font, text[i]);
+            if (used + adv > width && i > start) break; // at least one character per line
+            if (text[i] == ' ' && i > start && text[i - 1] != ' ') brk = i;
+            used += adv;
+        }
+        size_t end = i, next = i;
+        if (text[i] == '\n') {
+            next = i + 1;
+        } else if (text[i]) { // line is full
+            if (brk) end = next = brk;
+            while (text[next] == ' ') ++next;
+        }
+        CalTextLine& line = lines[count++];
+        line = {start, end - start, false};
+        if (count == maxLines && text[next]) {
+            // Last line, more text follows: as much as fits next to the ellipsis
+            int room = width - calTextWidth(font, CALTEXT_ELLIPSIS, sizeof(CALTEXT_ELLIPSIS) - 1);
+            size_t e = i;
+            while (e > start && used > room) used -= calTextAdvance(font, text[--e]);
+            while (e > start && text[e - 1] == ' ') --e;
+            line.length = e - start;
+            line.ellipsis = true;
+        }
+        pos = next;
+    }
+    return count;
+}
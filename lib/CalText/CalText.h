@@ -0,0 +1,26 @@
+// CalText.h - line breaking from GFX font metrics (glyph advances, no getTextBounds)
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <gfxfont.h>
+
+// Appended to the last line when the text does not fit into maxLines.
+static const char CALTEXT_ELLIPSIS[] = "...";
+
+// One output line: text[start, start + length), optionally followed by the ellipsis.
+struct CalTextLine {
+    size_t start;
+    size_t length;
+    bool ellipsis;
+};
+
+// Cursor advance of `c` in pixels; 0 for characters the font does not have
+// (GFX skips them when printing).
+int calTextAdvance(const GFXfont* font, char c);
+int calTextWidth(const GFXfont* font, const char* text, size_t len);
+
+// Greedy wrap in one pass: breaks at the last space that fits (or inside a
+// word longer than `width`) and at '\n'. Spaces at a wrap are dropped. If text
+// remains after `maxLines`, the last line is cut so that it fits together with
+// CALTEXT_ELLIPSIS. Returns the number of lines written to `lines`.
+size_t calTextWrap(const GFXfont* font, const char* text, int width, CalTextLine* lines, size_t maxLines);
@@ -0,0 +1,103 @@
+// CalTime.cpp
+#include "CalTime.h"
+#include <stdio.h>
+
+namespace {
+// Days since 1970-01-01 <-> civil date (H. Hinnant's algorithms).
+void civilFromDays(int32_t z, int& y, unsigned& m, unsigned& d) {
+    z += 719468;
+    int32_t era = (z >= 0 ? z : z - 146096) / 146097;
+    unsigned doe = (unsigned)(z - era * 146097);
+    unsigned yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    int32_t yy = (int32_t)yoe + era * 400;
+    unsigned doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    unsigned mp = (5 * doy + 2) / 153;
+    d = doy - (153 * mp + 2) / 5 + 1;
+    m = mp < 10 ? mp + 3 : mp - 9;
+    y = (int)(yy + (m <= 2));
+}
+
+int32_t daysFromCivil(int y, unsigned m, unsigned d) {
+    y -= m <= 2;
+    int32_t era = (y >= 0 ? y : y - 399) / 400;
+    unsigned yoe = (unsigned)(y - era * 400);
+    unsigned doy = (153 * (m > 2 ? m - 3 : m + 9) + 2) / 5 + d - 1;
+    unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + (int32_t)doe - 719468;
+}
+
+// Stops at the terminator, so short input never reads past the string.
+bool digits(const char* s, int n, int& out) {
+    out = 0;
+    for (int i = 0; i < n; ++i) {
+        if (s[i] < '0' || s[i] > '9') return false;
+        out = out * 10 + (s[i] - '0');
+    }
+    return true;
+}
+
+bool parseDate(const char* s, int& y, int& mo, int& d) {
+    return digits(s, 4, y) && s[4] == '-' && digits(s + 5, 2, mo) && s[7] == '-' && digits(s + 8, 2, d) &&
+           mo >= 1 && mo <= 12 && d >= 1 && d <= 31;
+}
+}
+
+bool calTimeParse(const char* iso, CalTime& out) {
+    int y, mo, d, h, mi, s = 0;
+    if (!parseDate(iso, y, mo, d) || iso[10] != 'T') return false;
+    if (!digits(iso + 11, 2, h) || iso[13] != ':' || !digits(iso + 14, 2, mi) || h > 23 || mi > 59) return false;
+    const char* p = iso + 16;
+    if (*p == ':') { if (!digits(p + 1, 2, s)) return false; p += 3; }
+    while (*p == '.' || (*p >= '0' && *p <= '9')) ++p; // fractional seconds
+    int off = 0;
+    if (*p == '+' || *p == '-') {
+        int oh, om;
+        const char* q = p + 1;
+        if (!digits(q, 2, oh)) return false;
+        q += 2;
+        if (*q == ':') ++q;
+        if (!digits(q, 2, om)) return false;
+        off = oh * 60 + om;
+        if (*p == '-') off = -off;
+    }
+    int32_t day = daysFromCivil(y, (unsigned)mo, (unsigned)d);
+    int32_t secs = h * 3600 + mi * 60 + s;
+    out.epoch = (uint32_t)((int64_t)day * 86400 + secs - (int64_t)off * 60);
+    out.offsetMin = (int16_t)off;
+    out.minutes = (uint16_t)(h * 60 + mi);
+    out.day = day;
+    return true;
+}
+
+void calTimeFromEpoch(uint32_t epoch, int16_t offsetMin, CalTime& out) {
+    int64_t local = (int64_t)epoch + (int64_t)offsetMin * 60;
+    int32_t day = (int32_t)(local / 86400);
+    int32_t secs = (int32_t)(local % 86400);
+    if (secs < 0) { secs += 86400; --day; }
+    out.epoch = epoch;
+    out.offsetMin = offsetMin;
+    out.minutes = (uint16_t)(secs / 60);
+    out.day = day;
+}
+
+void calTimeFormatIso(const CalTime& t, char* out, size_t outLen) {
+    int y; unsigned m, d;
+    civilFromDays(t.day, y, m, d);
+    int secs = (int)((t.epoch + (int64_t)t.offsetMin * 60) % 60 + 60) % 60;
+    int off = t.offsetMin < 0 ? -t.offsetMin : t.offsetMin;
+    snprintf(out, outLen, "%04d-%02u-%02uT%02d:%02d:%02d%c%02d%02d", y, m, d,
+             t.minutes / 60, t.minutes % 60, secs, t.offsetMin < 0 ? '-' : '+', off / 60, off % 60);
+}
+
+bool calTimeParseDay(const char* date, int32_t& day) {
+    int y, mo, d;
+    if (!parseDate(date, y, mo, d)) return false;
+    day = daysFromCivil(y, (unsigned)mo, (unsigned)d);
+    return true;
+}
+
+void calTimeFormatDay(int32_t day, char* out, size_t outLen) {
+    int y; unsigned m, d;
+    civilFromDays(day, y, m, d);
+    snprintf(out, outLen, "%04d-%02u-%02u", y, m, d);
+}
@@ -0,0 +1,27 @@
+// CalTime.h - ISO-8601 timestamps resolved once into integers
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+// A timestamp as used downstream: UTC epoch plus its local calendar position.
+// "Local" is the offset written in the timestamp (the host converts events to
+// the display's time zone before uploading).
+struct CalTime {
+    uint32_t epoch;      // UTC seconds
+    int16_t  offsetMin;  // e.g. +120 for "+0200"
+    uint16_t minutes;    // minutes from local midnight
+    int32_t  day;        // local day, days since 1970-01-01
+};
+
+// Parses "YYYY-MM-DDTHH:MM[:SS[.fff]][+HHMM|+HH:MM|Z]" without allocating.
+// A missing offset counts as +0000. Returns false if malformed.
+bool calTimeParse(const char* iso, CalTime& out);
+// Fills `out` from a UTC epoch and a local offset (no parsing).
+void calTimeFromEpoch(uint32_t epoch, int16_t offsetMin, CalTime& out);
+// Formats as "YYYY-MM-DDTHH:MM:SS+HHMM".
+void calTimeFormatIso(const CalTime& t, char* out, size_t outLen);
+
+// Local day of "YYYY-MM-DD" (anything after the date is ignored).
+bool calTimeParseDay(const char* date, int32_t& day);
+// Formats a local day as "YYYY-MM-DD" (`out` needs 11 bytes).
+void calTimeFormatDay(int32_t day, char* out, size_t outLen);
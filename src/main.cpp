@@ -6,173 +6,546 @@
 #include <SPI.h>
 #include <GxEPD2_4C.h>
 #include <epd4c/GxEPD2_0579c_GDEY0579F51.h>
-#include <Fonts/FreeSansBold12pt7b.h>
-#include <Fonts/FreeSansBold7pt7b.h>
-#include <Fonts/FreeSans7pt7b.h>
-#include <Fonts/FreeSans6pt7b.h>
-#include <Fonts/Font5x7Fixed.h>
-#include <Fonts/Font4x5Fixed.h>
-#include <Icons.h>
 #include <time.h>
+#include <algorithm>
 #include <FS.h>
 #include <SPIFFS.h>
 #include <ArduinoJson.h>
 #include <CalLayout.h> // local library in lib/CalLayout/
+#include <CalStream.h> // local library in lib/CalStream/
+#include <CalProto.h>
+#include <CalInflate.h>
+#include <CalBin.h>
+#include <CalRing.h>
+#include <CalDays.h>
+#include <CalEvents.h>
+#include <CalTime.h>
+#include <CalFrame.h>
+#include <CalDisplayList.h>
+#include <CalBand.h>
+#include <CalRender.h>
+#include <mbedtls/sha256.h> // auf dem ESP32 per SHA-Peripheral beschleunigt
 #include <NimBLEDevice.h>  // BLE hinzu
 #include <NimBLEUtils.h>
 
 // Optional Debug für Hash-Bildung aktivieren (1 = an, 0 = aus)
 #define CAL_HASH_DEBUG 1
+// Heap-Selbsttest beim Boot (1 = an): 1000 simulierte Uploads durch den Empfangspfad,
+// der größte freie Heap-Block muss stabil bleiben (siehe calHeapSelfTest)
+#define CAL_HEAP_SELFTEST 0
+// Seitenbetrieb des Displays: Panel-Zeilen pro Band (Vielfaches von 16), 0 = voller Puffer.
+// Gezeichnet wird dann in eine Display-Liste, die für jedes Band über der statischen Ebene aus dem
+// Flash abgespielt wird (siehe drawCalendar, showBands).
+#define CAL_PAGE_HEIGHT 32
+
+#if CAL_HEAP_SELFTEST
+#include <assert.h>
+#include <esp_heap_caps.h>
+#endif
 
 // ==== BLE UUIDs (beliebig, nur konsistent bleiben) ====
 static const char* BLE_SERVICE_UUID       = "7e20c560-55dd-4c7a-9c61-8f6ea7d7c301";
 static const char* BLE_CHARACTERISTIC_UUID = "9c5a5dd9-3c40-4e58-9d0a-95bf7cb9d302";
+static const char* BLE_NOTIFY_UUID         = "9c5a5dd9-3c40-4e58-9d0a-95bf7cb9d303"; // Credits / Quittungen
+static const char* BLE_STATUS_UUID         = "9c5a5dd9-3c40-4e58-9d0a-95bf7cb9d304"; // lesbarer Gerätestand
+// Unterstützte Header-Optionen (LEN<opts>:), im Status-Characteristic als caps= veröffentlicht
+static const char* BLE_CAPABILITIES = "FZDBRP";
 
-// Buffer für eingehende Kalenderdaten
-static String bleIncoming; // legacy (will phase out)
-static size_t bleExpectedLen = 0;
+// Buffer für eingehende Kalenderdaten (Zustand gehört dem Worker-Task, siehe calWorkerTask)
+static size_t bleExpectedLen = 0;     // Bytes auf der Leitung (ggf. komprimiert)
+static size_t bleRawLen = 0;          // Bytes nach dem Entpacken
 static bool bleForceOnFinish = false; // wird durch speziellen Header (LENF:) gesetzt
+static bool bleCompressed = false;    // LENZ: zlib-Stream, wird on-the-fly entpackt
+static bool bleDelta = false;         // LEND: CalBin-Delta gegen den gespeicherten Stand
+static uint32_t bleDeltaBase = 0;     // Set-Hash, auf dem das Delta aufsetzt
+static bool bleBench = false;         // LENB: Durchsatztest, Payload wird nur gezählt
+static bool bleFramed = false;        // LENR: Chunks mit Offset + CRC32, per RESUME fortsetzbar
+static bool bleFrame = false;         // LENP: fertiges Panel-Bild vom Host, geht ohne Parsen zum Panel
+static uint32_t bleFrameEvents = 0;   // Events-Hash der Termine im Bild
+static uint32_t bleTransferId = 0;
+static size_t bleNakPos = SIZE_MAX;   // zuletzt per NAK angeforderter Offset
+static uint32_t bleWriteCount = 0;    // empfangene Writes im laufenden Transfer
 static bool   bleTransferActive = false;
 static unsigned long bleLastChunkMillis = 0;
 static const uint32_t BLE_TRANSFER_TIMEOUT_MS = 5000;
-static char* bleBuffer = nullptr;
-static size_t bleBufferWritePos = 0;
+static const uint32_t BLE_RESUME_TIMEOUT_MS = 300000; // gerahmte Transfers überleben Verbindungsabbrüche
+static size_t bleBufferWritePos = 0;  // empfangene Leitungs-Bytes
+static size_t bleRawPos = 0;          // Füllstand von bleArena (Rohdaten)
+static mbedtls_sha256_context bleSha; // SHA-256 der Rohdaten, läuft beim Empfang mit
+static bool bleDeferParse = false;    // evtl. byte-gleich mit der gespeicherten Datei: erst Digest, dann Parsen
+static CalInflate bleInflate;
+
+// Übergabe NimBLE-Callback -> Worker-Task; fasst ein Credit-Fenster plus Längenpräfixe
+static uint8_t bleRingStorage[8192];
+static CalRing bleRing;
+static std::atomic<bool> bleRingOverflow{false};
+static TaskHandle_t calWorker = nullptr;
 static const size_t BLE_MAX_PAYLOAD = 60000; // sanity limit to avoid huge allocations
+// Empfangspuffer (Rohdaten nach dem Entpacken): statisch reserviert und von jedem Transfer
+// wiederverwendet. Ein malloc/free pro Upload würde den Heap über Wochen Laufzeit zerstückeln.
+static char bleArena[BLE_MAX_PAYLOAD];
+// LENP: 792 x 272 Pixel, 2 Bit/Pixel in Panel-Zeilen (CalPanel::WIDTH / 4 * CalPanel::HEIGHT)
+static const size_t BLE_FRAME_BYTES = 792 / 4 * 272;
+static_assert(BLE_FRAME_BYTES <= BLE_MAX_PAYLOAD, "LENP: Panel-Bild muss in die Arena passen");
+
+// Flusskontrolle: Host darf bis <limit> Leitungs-Bytes senden (ACK:<empfangen>:<limit>),
+// neue Credits gibt es nach jeweils einem halben Fenster
+static NimBLECharacteristic* bleNotifyChr = nullptr;
+static NimBLECharacteristic* bleStatusChr = nullptr;
+static const size_t BLE_CREDIT_WINDOW = 4096;
+static size_t bleAckedPos = 0;
+static unsigned long bleStartMillis = 0;
+
+// Verbindungsparameter (Intervall in 1,25 ms, Timeout in 10 ms): kurz während eines
+// Transfers, danach wieder sparsam
+static const uint16_t BLE_CONN_FAST_MIN = 6;   // 7,5 ms
+static const uint16_t BLE_CONN_FAST_MAX = 12;  // 15 ms
+static const uint16_t BLE_CONN_IDLE_MIN = 80;  // 100 ms
+static const uint16_t BLE_CONN_IDLE_MAX = 160; // 200 ms
+static const uint16_t BLE_CONN_TIMEOUT = 400;  // 4 s
+static const uint16_t BLE_DATA_LEN = 251;      // maximale LL-PDU (Data Length Extension)
+static NimBLEServer* bleServer = nullptr;
+static uint16_t bleConnHandle = BLE_HS_CONN_HANDLE_NONE;
+static bool bleLinkFast = false;
 
 // Vorwärtsdeklaration
-bool updateCalendarFromJson(const String& jsonStr, bool forceRefresh);
-void saveCalendarFile(const String& jsonStr) {
-  File f = SPIFFS.open("/calendar-condensed.json", "w");
+void beginCalendarStream();
+void feedCalendarStream(const char* data, size_t len);
+bool endCalendarStream(const char* payload, size_t len);
+bool finishCalendarStream(bool forceRefresh);
+bool applyCalendarDelta(const uint8_t* delta, size_t len, uint32_t base, std::vector<uint8_t>& merged);
+void bleUpdateStatus();
+void saveDayCache();
+bool calPayloadMaybeUnchanged(size_t rawLen);
+bool calPayloadUnchanged(const uint8_t* sha, size_t len);
+void rememberPayloadDigest(const uint8_t* sha, size_t len);
+void calCheckDayRollover();
+bool updateCalendarFromFile(bool forceRefresh);
+void showPanelFrame(const uint8_t* frame, uint32_t eventsHash, bool forceRefresh);
+
+// Kalenderdaten liegen entweder als CalBin oder als JSON im Flash (nie beide)
+static const char* CAL_FILE_BIN = "/calendar.bin";
+static const char* CAL_FILE_JSON = "/calendar-condensed.json";
+// Tages-Cache (CalDays): pro Tag fertig gelayoutete Events, wird mit jeder Kalenderdatei neu geschrieben
+static const char* CAL_FILE_DAYS = "/days.bin";
+// Kachel-Digests des zuletzt angezeigten Frames (CalFrame), für das Überspringen identischer Refreshes
+static const char* CAL_FILE_FRAME = "/frame.bin";
+// SHA-256 + Länge der gespeicherten Kalenderdatei (Kopie des RTC-Werts, übersteht Power-On)
+static const char* CAL_FILE_DIGEST = "/calendar.sha";
+
+// Schreibt direkt aus dem Empfangspuffer (keine String-Kopie); `sha` = SHA-256 von `data`
+void saveCalendarFile(const char* data, size_t len, const uint8_t* sha) {
+  bool binary = calBinIsBinary((const uint8_t*)data, len);
+  const char* path = binary ? CAL_FILE_BIN : CAL_FILE_JSON;
+  // Cache zuerst entfernen: ein Abbruch dazwischen darf keinen veralteten Cache hinterlassen
+  if (SPIFFS.exists(CAL_FILE_DAYS)) SPIFFS.remove(CAL_FILE_DAYS);
+  rememberPayloadDigest(nullptr, 0);
+  File f = SPIFFS.open(path, "w");
   if (!f) { Serial.println("Kalender-Datei speichern fehlgeschlagen!"); return; }
-  f.print(jsonStr);
+  size_t written = f.write((const uint8_t*)data, len);
   f.close();
-  Serial.println("Kalender-Datei gespeichert (/calendar-condensed.json).");
+  if (written != len) {
+    Serial.printf("Kalender-Datei unvollständig geschrieben (%u / %u)!\n", (unsigned)written, (unsigned)len);
+    return;
+  }
+  const char* other = binary ? CAL_FILE_JSON : CAL_FILE_BIN;
+  if (SPIFFS.exists(other)) SPIFFS.remove(other);
+  Serial.printf("Kalender-Datei gespeichert (%s).\n", path);
+  rememberPayloadDigest(sha, len);
+  saveDayCache(); // aus demselben Parse-Durchlauf (endCalendarStream lief vorher)
+}
+
+// Kurze Textzeile an den Host (ACK:/DONE:/ERR:), ohne Abonnent wirkungslos
+static void bleNotify(const char* fmt, ...) {
+  if (!bleNotifyChr) return;
+  char line[48];
+  va_list ap;
+  va_start(ap, fmt);
+  int n = vsnprintf(line, sizeof(line), fmt, ap);
+  va_end(ap);
+  if (n <= 0) return;
+  bleNotifyChr->notify((const uint8_t*)line, min((size_t)n, sizeof(line) - 1));
+}
+
+static void bleGrantCredits(bool force) {
+  if (!force && bleBufferWritePos - bleAckedPos < BLE_CREDIT_WINDOW / 2) return;
+  bleAckedPos = bleBufferWritePos;
+  bleNotify("ACK:%u:%u\n", (unsigned)bleAckedPos, (unsigned)(bleAckedPos + BLE_CREDIT_WINDOW));
+  // Fortschritt nur pro Fenster loggen, Serial-Ausgabe pro Chunk bremst den Empfang
+  Serial.printf("BLE Fortschritt: %u / %u (%.1f%%)\n", (unsigned)bleBufferWritePos, (unsigned)bleExpectedLen,
+                (bleBufferWritePos * 100.0f) / bleExpectedLen);
+}
+
+static void bleSetLinkSpeed(bool fast) {
+  if (!bleServer || bleConnHandle == BLE_HS_CONN_HANDLE_NONE || fast == bleLinkFast) return;
+  bleLinkFast = fast;
+  if (fast) bleServer->updateConnParams(bleConnHandle, BLE_CONN_FAST_MIN, BLE_CONN_FAST_MAX, 0, BLE_CONN_TIMEOUT);
+  else      bleServer->updateConnParams(bleConnHandle, BLE_CONN_IDLE_MIN, BLE_CONN_IDLE_MAX, 0, BLE_CONN_TIMEOUT);
+}
+
+static void bleResetTransfer() {
+  bleTransferActive = false;
+  bleExpectedLen = 0;
+  bleRawLen = 0;
+  bleBufferWritePos = 0;
+  bleRawPos = 0;
+  bleAckedPos = 0;
+  bleForceOnFinish = false;
+  bleCompressed = false;
+  bleDelta = false;
+  bleDeltaBase = 0;
+  bleBench = false;
+  bleFramed = false;
+  bleFrame = false;
+  bleFrameEvents = 0;
+  bleTransferId = 0;
+  bleNakPos = SIZE_MAX;
+  bleWriteCount = 0;
+  bleInflate.end();
+  bleDeferParse = false;
+  mbedtls_sha256_free(&bleSha); // gibt ggf. die SHA-Hardware frei
+  mbedtls_sha256_init(&bleSha);
+  bleSetLinkSpeed(false);
+}
+
+// Payload-Bytes übernehmen: einmal aus dem Ring in die Arena kopieren oder direkt dorthin
+// entpacken; der Parser sieht die Rohdaten in der Arena
+static bool bleIngest(const uint8_t* data, size_t len) {
+  if (bleBufferWritePos + len > bleExpectedLen) {
+    len = bleExpectedLen - bleBufferWritePos; // clamp overflow
+  }
+  bleBufferWritePos += len;
+  if (!len || bleBench) return true;
+  char* out = bleArena + bleRawPos;
+  size_t produced = len;
+  if (bleCompressed) {
+    if (!bleInflate.feed(data, len, produced)) {
+      Serial.println("Entpacken fehlgeschlagen – Transfer verworfen.");
+      return false;
+    }
+  } else {
+    memcpy(out, data, len);
+  }
+  if (produced && !bleDelta && !bleFrame) { // Deltas erst nach dem Mergen, Panel-Bilder nie
+    mbedtls_sha256_update(&bleSha, (const uint8_t*)out, produced);
+    if (!bleDeferParse) feedCalendarStream(out, produced);
+  }
+  bleRawPos += produced;
+  return true;
+}
+
+// Fehlenden Offset anfordern (Lücke oder CRC-Fehler); pro Lücke nur einmal
+static void bleRequestMissing() {
+  if (bleNakPos == bleBufferWritePos) return;
+  bleNakPos = bleBufferWritePos;
+  bleNotify("NAK:%u\n", (unsigned)bleBufferWritePos);
+}
+
+// Gerahmter Chunk: nur lückenlos anschließende Daten werden übernommen (Entpacken und
+// Parser laufen streng sequentiell), Duplikate nach einem Rücksprung des Hosts ignoriert
+static bool bleIngestFrame(const uint8_t* data, size_t len) {
+  uint32_t offset;
+  const uint8_t* payload;
+  size_t n;
+  if (!calParseFrame(data, len, offset, payload, n)) {
+    Serial.println("Chunk mit CRC-Fehler verworfen.");
+    bleRequestMissing();
+    return true;
+  }
+  if (offset + n <= bleBufferWritePos) return true;
+  if (offset > bleBufferWritePos) {
+    bleRequestMissing();
+    return true;
+  }
+  size_t skip = bleBufferWritePos - offset;
+  return bleIngest(payload + skip, n - skip);
+}
+
+// RESUME:<id> – Host (neu verbunden oder ohne Credits) fragt nach dem ersten fehlenden Offset
+static void bleResume(const char* data, size_t len) {
+  const char* nl = (const char*)memchr(data, '\n', len);
+  uint32_t id;
+  if (!nl || !calParseResume(data, nl - data, id)) {
+    bleNotify("ERR:HEADER\n");
+    return;
+  }
+  if (!bleTransferActive || !bleFramed || id != bleTransferId) {
+    Serial.println("RESUME ohne passenden Transfer.");
+    bleNotify("ERR:NORESUME\n");
+    return;
+  }
+  Serial.printf("Transfer wird bei %u / %u fortgesetzt.\n", (unsigned)bleBufferWritePos, (unsigned)bleExpectedLen);
+  bleNakPos = SIZE_MAX;
+  bleLastChunkMillis = millis();
+  bleSetLinkSpeed(true);
+  bleNotify("RESUME:%u\n", (unsigned)bleBufferWritePos);
+  bleGrantCredits(true);
 }
 
 // BLE Callback
-class CalendarCharCallbacks : public NimBLECharacteristicCallbacks {
-  void onWrite(NimBLECharacteristic* chr, NimBLEConnInfo& connInfo) override {
-    std::string v = chr->getValue();
-    if (v.empty()) return;
-
-    // Neuer Transfer erwartet ersten Chunk mit "LEN:<zahl>\n"
-    // Sonderkommando: TIME:<epochSeconds>\n  -> setzt Systemzeit (UTC) und kehrt zurück
-    if (!bleTransferActive && v.rfind("TIME:", 0) == 0) {
-      size_t nl = v.find('\n');
-      if (nl == std::string::npos) {
-        Serial.println("TIME Header ohne Newline – ignoriert.");
-        return;
-      }
-      std::string num = v.substr(5, nl-5);
-      long long epoch = atoll(num.c_str());
-      if (epoch > 100000) {
-        struct timeval tv;
-        tv.tv_sec = (time_t)epoch;
-        tv.tv_usec = 0;
-        if (settimeofday(&tv, nullptr) == 0) {
-          Serial.printf("Zeit per BLE gesetzt (UTC Epoch): %lld\n", epoch);
-          // Sicherstellen, dass Zeitzone gesetzt ist (falls WiFi/NTP übersprungen wurde)
-          setenv("TZ","CET-1CEST,M3.5.0,M10.5.0/3",1); tzset();
-        } else {
-          Serial.println("settimeofday fehlgeschlagen");
-        }
+// Verarbeitet einen BLE-Write. Läuft nur im Worker-Task, dem damit der gesamte
+// Transferzustand (bleTransferActive, Puffer, Parser) allein gehört.
+static void calHandleChunk(const char* data, size_t len) {
+  // In gerahmten Transfers sind Befehle eindeutig: ein Frame-Offset "TIME"/"LEN…"/"RESU"
+  // läge weit jenseits von BLE_MAX_PAYLOAD
+  bool commands = !bleTransferActive || bleFramed;
+
+  // Neuer Transfer erwartet ersten Chunk mit "LEN:<zahl>\n"
+  // Sonderkommando: TIME:<epochSeconds>\n  -> setzt Systemzeit (UTC) und kehrt zurück
+  if (commands && len >= 5 && memcmp(data, "TIME:", 5) == 0) {
+    if (!memchr(data, '\n', len)) {
+      Serial.println("TIME Header ohne Newline – ignoriert.");
+      return;
+    }
+    long long epoch = atoll(data + 5); // endet am '\n'
+    if (epoch > 100000) {
+      struct timeval tv;
+      tv.tv_sec = (time_t)epoch;
+      tv.tv_usec = 0;
+      if (settimeofday(&tv, nullptr) == 0) {
+        Serial.printf("Zeit per BLE gesetzt (UTC Epoch): %lld\n", epoch);
+        // Sicherstellen, dass Zeitzone gesetzt ist (falls WiFi/NTP übersprungen wurde)
+        setenv("TZ","CET-1CEST,M3.5.0,M10.5.0/3",1); tzset();
       } else {
-        Serial.println("TIME Wert ungueltig");
+        Serial.println("settimeofday fehlgeschlagen");
       }
-      return; // kein Kalendertransfer starten
+    } else {
+      Serial.println("TIME Wert ungueltig");
     }
+    return; // kein Kalendertransfer starten
+  }
+  if (commands && len >= 7 && memcmp(data, "RESUME:", 7) == 0) {
+    bleResume(data, len);
+    return;
+  }
 
-    if (!bleTransferActive) {
-      if (v.rfind("LENF:", 0) == 0 || v.rfind("LEN:", 0) == 0) {
-        size_t nlPos = v.find('\n');
-        if (nlPos == std::string::npos) {
-          Serial.println("LEN Header ohne Newline – Chunk verworfen.");
-          return;
-        }
-        std::string headerStd = v.substr(0, nlPos); // z.B. "LEN:1234" oder "LENF:1234"
-        if (headerStd.size() < 5) {
-          Serial.println("LEN Header zu kurz – verworfen.");
-          return;
-        }
-        bool force = (headerStd.rfind("LENF:", 0) == 0);
-        bleForceOnFinish = force; // merken
-        long declared = strtol(headerStd.c_str() + (force?5:4), nullptr, 10);
-        if (declared <= 0) {
-          Serial.println("LEN Wert ungültig (<=0) – verworfen.");
-          return;
-        }
-        if (declared > (long)BLE_MAX_PAYLOAD) {
-          Serial.printf("LEN %ld überschreitet Limit (%u) – verworfen.\n", declared, (unsigned)BLE_MAX_PAYLOAD);
-          return;
-        }
-        bleExpectedLen = (size_t)declared;
-        // Allocate / reallocate buffer
-        if (bleBuffer) { free(bleBuffer); bleBuffer = nullptr; }
-        bleBuffer = (char*)malloc(bleExpectedLen + 1);
-        if (!bleBuffer) {
-          Serial.println("Malloc fehlgeschlagen – Abbruch.");
-          return;
-        }
-        bleBufferWritePos = 0;
-        size_t restOffset = nlPos + 1; // nach dem '\n'
-        if (restOffset < v.size()) {
-          std::string rest = v.substr(restOffset);
-          size_t restLen = rest.size();
-          if (restLen) {
-            if (restLen > bleExpectedLen) restLen = bleExpectedLen; // clamp
-            memcpy(bleBuffer, rest.data(), restLen);
-            bleBufferWritePos = restLen;
-          }
-          Serial.printf("(Header Chunk enthielt bereits %u Payload-Bytes)\n", (unsigned)restLen);
-        } else {
-          Serial.println("(Header Chunk ohne sofortige Payload)");
-        }
-        bleTransferActive = true;
-        bleLastChunkMillis = millis();
-        Serial.printf("BLE Transfer gestartet. Erwartete Länge: %u  (force=%s)\n", (unsigned)bleExpectedLen, bleForceOnFinish?"ja":"nein");
-      } else {
-        Serial.println("Erster Chunk ohne LEN:-Header – ignoriert.");
+  if (!bleTransferActive || (bleFramed && calIsTransferHeader(data, len))) {
+    if (!calIsTransferHeader(data, len)) {
+      Serial.println("Erster Chunk ohne LEN:-Header – ignoriert.");
+      return;
+    }
+    const char* nl = (const char*)memchr(data, '\n', len);
+    if (!nl) {
+      Serial.println("LEN Header ohne Newline – Chunk verworfen.");
+      return;
+    }
+    CalTransferHeader hdr;
+    size_t nlPos = nl - data;
+    if (!calParseTransferHeader(data, nlPos, hdr)) {
+      Serial.println("LEN Header ungültig – verworfen.");
+      bleNotify("ERR:HEADER\n");
+      return;
+    }
+    if (hdr.wireLength == 0 || hdr.rawLength == 0) {
+      Serial.println("LEN Wert ungültig (<=0) – verworfen.");
+      bleNotify("ERR:HEADER\n");
+      return;
+    }
+    if (!hdr.bench && hdr.rawLength > BLE_MAX_PAYLOAD) {
+      Serial.printf("LEN %u überschreitet Limit (%u) – verworfen.\n", (unsigned)hdr.rawLength, (unsigned)BLE_MAX_PAYLOAD);
+      bleNotify("ERR:SIZE\n");
+      return;
+    }
+    if (hdr.frame && (hdr.rawLength != BLE_FRAME_BYTES || hdr.delta || hdr.bench)) {
+      Serial.printf("LENP mit %u Bytes (erwartet %u) – verworfen.\n", (unsigned)hdr.rawLength, (unsigned)BLE_FRAME_BYTES);
+      bleNotify("ERR:SIZE\n");
+      return;
+    }
+    bleResetTransfer();
+    bleForceOnFinish = hdr.force; // merken
+    bleCompressed = hdr.compressed;
+    bleDelta = hdr.delta;
+    bleDeltaBase = hdr.baseHash;
+    bleBench = hdr.bench;
+    bleFramed = hdr.framed;
+    bleFrame = hdr.frame;
+    bleFrameEvents = hdr.eventsHash;
+    bleTransferId = hdr.transferId;
+    bleExpectedLen = hdr.wireLength;
+    bleRawLen = hdr.rawLength;
+    // Arena nimmt die entpackten Daten auf (rawLength <= BLE_MAX_PAYLOAD ist oben geprüft)
+    if (bleCompressed && !bleInflate.begin((uint8_t*)bleArena, bleRawLen)) {
+      Serial.println("Inflate-Init fehlgeschlagen – Abbruch.");
+      bleNotify("ERR:NOMEM\n");
+      bleResetTransfer();
+      return;
+    }
+    if (!bleDelta && !bleBench && !bleFrame) {
+      beginCalendarStream(); // Parser läuft ab dem ersten Payload-Byte mit ...
+      mbedtls_sha256_starts(&bleSha, 0);
+      // ... außer der Upload ist vermutlich eine Wiederholung: dann entscheidet erst der Digest
+      bleDeferParse = calPayloadMaybeUnchanged(bleRawLen);
+    }
+    bleSetLinkSpeed(true);
+    bleTransferActive = true;
+    bleWriteCount = 1;
+    bleLastChunkMillis = millis();
+    bleStartMillis = bleLastChunkMillis;
+    size_t restOffset = nlPos + 1; // nach dem '\n'
+    if (restOffset < len) {
+      size_t restLen = len - restOffset;
+      bool ok = bleFramed ? bleIngestFrame((const uint8_t*)data + restOffset, restLen)
+                          : bleIngest((const uint8_t*)data + restOffset, restLen);
+      if (!ok) {
+        bleNotify("ERR:INFLATE\n");
+        bleResetTransfer();
         return;
       }
+      Serial.printf("(Header Chunk enthielt bereits %u Payload-Bytes)\n", (unsigned)restLen);
     } else {
-      // Fortsetzungs-Chunks direkt in Buffer kopieren
-      size_t addLen = v.size();
-      if (bleBufferWritePos + addLen > bleExpectedLen) {
-        addLen = bleExpectedLen - bleBufferWritePos; // clamp overflow
-      }
-      if (addLen) memcpy(bleBuffer + bleBufferWritePos, v.data(), addLen);
-      bleBufferWritePos += addLen;
-      bleLastChunkMillis = millis();
+      Serial.println("(Header Chunk ohne sofortige Payload)");
     }
+    Serial.printf("BLE Transfer gestartet. Erwartete Länge: %u  (roh %u, komprimiert=%s, delta=%s, bild=%s, force=%s)\n",
+                  (unsigned)bleExpectedLen, (unsigned)bleRawLen, bleCompressed?"ja":"nein", bleDelta?"ja":"nein",
+                  bleFrame?"ja":"nein", bleForceOnFinish?"ja":"nein");
+    bleGrantCredits(true); // erstes Fenster freigeben
+  } else {
+    // Fortsetzungs-Chunks direkt in Buffer kopieren bzw. entpacken
+    bool ok = bleFramed ? bleIngestFrame((const uint8_t*)data, len) : bleIngest((const uint8_t*)data, len);
+    if (!ok) {
+      bleNotify("ERR:INFLATE\n");
+      bleResetTransfer();
+      return;
+    }
+    bleLastChunkMillis = millis();
+    bleWriteCount++;
+    if (bleBufferWritePos < bleExpectedLen) bleGrantCredits(false);
+  }
 
-    // Fortschritt / Abschluss prüfen
-    if (bleTransferActive) {
-      size_t have = bleBufferWritePos;
-      Serial.printf("BLE Fortschritt: %u / %u (%.1f%%)\n", (unsigned)have, (unsigned)bleExpectedLen, (have * 100.0f) / bleExpectedLen);
-      if (have >= bleExpectedLen) {
-        Serial.println("BLE Transfer komplett. Prüfe / speichere JSON...");
-        bleTransferActive = false;
-        if (bleBuffer) bleBuffer[bleExpectedLen] = '\0';
-        String jsonStr = String(bleBuffer ? bleBuffer : "");
-        saveCalendarFile(jsonStr);
-        if (!updateCalendarFromJson(jsonStr, bleForceOnFinish)) {
+  // Fortschritt / Abschluss prüfen
+  if (bleTransferActive) {
+    size_t have = bleBufferWritePos;
+    if (have >= bleExpectedLen) {
+      unsigned long elapsed = millis() - bleStartMillis;
+      Serial.printf("BLE Transfer komplett: %u Bytes, %u Writes in %lu ms (%.1f kB/s)\n",
+                    (unsigned)have, (unsigned)bleWriteCount, elapsed, elapsed ? have / (float)elapsed : 0.0f);
+      bool complete = bleRawPos == bleRawLen && (!bleCompressed || bleInflate.done());
+      if (bleBench) {
+        bleNotify("DONE:%u:%lu:%u\n", (unsigned)have, elapsed, (unsigned)bleWriteCount);
+      } else if (!complete) {
+        Serial.printf("Payload unvollständig (%u / %u Bytes) – verworfen.\n", (unsigned)bleRawPos, (unsigned)bleRawLen);
+        bleNotify("ERR:INCOMPLETE\n");
+      } else if (bleFrame) {
+        // Vom Host gerendert: Parsen, Layout und Textsatz entfallen, die Arena geht direkt zum Panel.
+        // Die Kalenderdatei bleibt unverändert (Fallback für Tageswechsel und Neustart).
+        bleNotify("DONE:%u:%lu:%u\n", (unsigned)have, elapsed, (unsigned)bleWriteCount);
+        showPanelFrame((const uint8_t*)bleArena, bleFrameEvents, bleForceOnFinish);
+      } else if (bleDelta) {
+        // Delta auf den gespeicherten Stand anwenden; das Ergebnis läuft wie ein voller Upload durch
+        std::vector<uint8_t> merged;
+        if (applyCalendarDelta((const uint8_t*)bleArena, bleRawPos, bleDeltaBase, merged)) {
+          beginCalendarStream();
+          feedCalendarStream((const char*)merged.data(), merged.size());
+          if (endCalendarStream((const char*)merged.data(), merged.size())) {
+            uint8_t sha[32];
+            mbedtls_sha256_starts(&bleSha, 0);
+            mbedtls_sha256_update(&bleSha, merged.data(), merged.size());
+            mbedtls_sha256_finish(&bleSha, sha);
+            saveCalendarFile((const char*)merged.data(), merged.size(), sha);
+            bleNotify("DONE:%u:%lu:%u\n", (unsigned)have, elapsed, (unsigned)bleWriteCount);
+          } else {
+            bleNotify("ERR:PARSE\n");
+          }
+          if (!finishCalendarStream(bleForceOnFinish)) {
+            Serial.println("Delta Update fehlgeschlagen oder übersprungen.");
+          }
+        } else {
+          bleNotify("ERR:DELTA\n"); // Host sendet daraufhin den vollen Kalender
+        }
+      } else {
+        uint8_t sha[32];
+        mbedtls_sha256_finish(&bleSha, sha);
+        if (bleDeferParse && calPayloadUnchanged(sha, bleRawPos)) {
+          // Byte-gleich mit der gespeicherten Datei, gleiches Datum, kein LENF: Parsen, Speichern,
+          // Layout und Redraw entfallen, Anzeige und Status sind bereits aktuell
+          Serial.println("Upload byte-gleich mit der gespeicherten Datei – übersprungen.");
+          bleNotify("DONE:%u:%lu:%u\n", (unsigned)have, elapsed, (unsigned)bleWriteCount);
+          bleResetTransfer();
+          return;
+        }
+        // Doch verschieden: zurückgehaltene Rohdaten jetzt am Stück aus der Arena parsen
+        if (bleDeferParse) feedCalendarStream(bleArena, bleRawPos);
+        // JSON ist zu diesem Zeitpunkt bereits vollständig geparst; nur gültige Daten speichern,
+        // damit ein defekter Upload die letzte gute Datei nicht überschreibt.
+        // DONE geht vor dem Redraw raus, der Host muss nicht auf das Display warten.
+        if (endCalendarStream(bleArena, bleRawPos)) {
+          saveCalendarFile(bleArena, bleRawPos, sha);
+          bleNotify("DONE:%u:%lu:%u\n", (unsigned)have, elapsed, (unsigned)bleWriteCount);
+        } else {
+          bleNotify("ERR:PARSE\n");
+        }
+        if (!finishCalendarStream(bleForceOnFinish)) {
           Serial.println("JSON Update fehlgeschlagen oder übersprungen.");
         }
-        bleExpectedLen = 0;
-        if (bleBuffer) { free(bleBuffer); bleBuffer = nullptr; }
-        bleBufferWritePos = 0;
-        bleForceOnFinish = false;
       }
+      bleResetTransfer();
     }
   }
+}
+
+// NimBLE-Callback kopiert nur in den Ring; Parsen, Speichern und Display-Refresh
+// (mehrere Sekunden) laufen im Worker, der BLE-Stack bleibt bedienbar
+class CalendarCharCallbacks : public NimBLECharacteristicCallbacks {
+  void onWrite(NimBLECharacteristic* chr, NimBLEConnInfo& connInfo) override {
+    const NimBLEAttValue& v = chr->getValue();
+    if (v.size() == 0) return;
+    if (!bleRing.push(v.data(), v.size())) bleRingOverflow.store(true, std::memory_order_relaxed);
+    if (calWorker) xTaskNotifyGive(calWorker);
+  }
 };
 
+static void calWorkerTask(void*) {
+  for (;;) {
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(200));
+    // Gerahmte Transfers erkennen die Lücke selbst und fordern per NAK nach
+    if (bleRingOverflow.exchange(false) && bleTransferActive && !bleFramed) {
+      // Host hat die Credits ignoriert; Transfer ist lückenhaft
+      Serial.println("BLE Empfangsring voll – Transfer verworfen.");
+      bleNotify("ERR:OVERFLOW\n");
+      bleResetTransfer();
+    }
+    // Records direkt im Ring verarbeiten (keine Zwischenkopie), erst danach freigeben
+    size_t n;
+    const uint8_t* chunk;
+    while ((chunk = bleRing.peek(n)) != nullptr) {
+      calHandleChunk((const char*)chunk, n);
+      bleRing.release();
+    }
+    uint32_t timeout = bleFramed ? BLE_RESUME_TIMEOUT_MS : BLE_TRANSFER_TIMEOUT_MS;
+    if (bleTransferActive && millis() - bleLastChunkMillis > timeout) {
+      Serial.println("BLE Transfer Timeout – Reset.");
+      bleNotify("ERR:TIMEOUT\n");
+      bleResetTransfer();
+    }
+    calCheckDayRollover();
+  }
+}
+
 class RestartAdvServerCallbacks : public NimBLEServerCallbacks {
   void onConnect(NimBLEServer* s, NimBLEConnInfo& connInfo) override {
     Serial.println("BLE verbunden");
+    bleConnHandle = connInfo.getConnHandle();
+    bleLinkFast = false;
+    // Große LL-PDUs und (falls vom Chip unterstützt) 2M PHY; das Intervall folgt pro Transfer
+    s->setDataLen(bleConnHandle, BLE_DATA_LEN);
+#if defined(CONFIG_IDF_TARGET_ESP32C3) || defined(CONFIG_IDF_TARGET_ESP32S3)
+    s->updatePhy(bleConnHandle, BLE_GAP_LE_PHY_2M_MASK, BLE_GAP_LE_PHY_2M_MASK, BLE_GAP_LE_PHY_CODED_ANY);
+#endif
+  }
+  void onConnParamsUpdate(NimBLEConnInfo& connInfo) override {
+    Serial.printf("BLE Verbindungsintervall: %.2f ms, Latenz %u, Timeout %u ms\n", connInfo.getConnInterval() * 1.25f,
+                  (unsigned)connInfo.getConnLatency(), (unsigned)connInfo.getConnTimeout() * 10);
+  }
+  void onPhyUpdate(NimBLEConnInfo& connInfo, uint8_t txPhy, uint8_t rxPhy) override {
+    Serial.printf("BLE PHY: tx %u, rx %u (1 = 1M, 2 = 2M)\n", (unsigned)txPhy, (unsigned)rxPhy);
+  }
+  void onMTUChange(uint16_t mtu, NimBLEConnInfo& connInfo) override {
+    Serial.printf("BLE MTU: %u\n", (unsigned)mtu);
   }
   void onDisconnect(NimBLEServer* s, NimBLEConnInfo& connInfo, int reason) override {
     Serial.println("BLE getrennt. Starte Advertising neu...");
+    bleConnHandle = BLE_HS_CONN_HANDLE_NONE;
+    bleLinkFast = false;
     NimBLEDevice::startAdvertising();
   }
 };
@@ -193,6 +566,7 @@ void initBLE() {
 #endif
   NimBLEDevice::setMTU(247); // größere MTU für weniger Chunks
   NimBLEServer* server = NimBLEDevice::createServer();
+  bleServer = server;
   server->setCallbacks(new RestartAdvServerCallbacks());
   NimBLEService* svc = server->createService(BLE_SERVICE_UUID);
   NimBLECharacteristic* chr = svc->createCharacteristic(
@@ -200,6 +574,9 @@ void initBLE() {
       NIMBLE_PROPERTY::WRITE | NIMBLE_PROPERTY::WRITE_NR
   );
   chr->setCallbacks(new CalendarCharCallbacks());
+  bleNotifyChr = svc->createCharacteristic(BLE_NOTIFY_UUID, NIMBLE_PROPERTY::NOTIFY);
+  bleStatusChr = svc->createCharacteristic(BLE_STATUS_UUID, NIMBLE_PROPERTY::READ);
+  bleUpdateStatus();
   svc->start();
   NimBLEAdvertising* adv = NimBLEDevice::getAdvertising();
   adv->addServiceUUID(BLE_SERVICE_UUID);
@@ -229,38 +606,146 @@ void initBLE() {
 #define EPD_SCK 6 // D4 yellow
 #define EPD_MOSI 10 // D10 blue
 
-GxEPD2_4C<GxEPD2_0579c_GDEY0579F51, GxEPD2_0579c_GDEY0579F51::HEIGHT> display(
-    GxEPD2_0579c_GDEY0579F51(EPD_CS, EPD_DC, EPD_RST, EPD_BUSY));
+// Panel-Treiber mit Frame-Diff: GxEPD2_4C reicht bei display() den kompletten nativen Puffer
+// (2 Bit/Pixel) an writeNative() weiter, im Seitenbetrieb (CAL_PAGE_HEIGHT) kommt der Frame aus
+// showBands() als Bänder voller Breite. Deren 16x16-Kacheln werden mit den Digests des zuletzt angezeigten Frames
+// (/frame.bin, überlebt Reset und Stromausfall wie das Panel-Bild) verglichen, sobald das letzte
+// Band da ist. Ist kein Pixel anders, entfallen Übertragung und Refresh – der teuerste Schritt überhaupt.
+class CalPanel : public GxEPD2_0579c_GDEY0579F51
+{
+public:
+  using GxEPD2_0579c_GDEY0579F51::GxEPD2_0579c_GDEY0579F51;
+
+  // Vor display(): false erzwingt den Refresh (LENF:). Änderungen nur in `ignore` (Bildschirm-
+  // Koordinaten, z.B. die Uhrzeit) lösen keinen Refresh aus.
+  void compareNextFrame(bool enabled, int16_t x = 0, int16_t y = 0, int16_t w = 0, int16_t h = 0)
+  {
+    _compare = enabled;
+    _skipped = false;
+    // Rotation 1 -> Panel-Koordinaten (wie GxEPD2 _rotate)
+    _ignore = {0, 0, 0, 0};
+    if (w > 0 && h > 0 && x >= 0 && y >= 0 && y + h <= WIDTH)
+      _ignore = {(uint16_t)(WIDTH - y - h), (uint16_t)x, (uint16_t)h, (uint16_t)w};
+  }
+  bool lastFrameSkipped() const { return _skipped; }
+
+  // Seitenbetrieb: Bänder gehen sofort zum Panel, bevor der Vergleich feststeht. Ein Durchlauf mit
+  // digestOnly(true) berechnet nur die Digests (kein Transfer, kein Refresh), danach lastFrameSkipped().
+  void digestOnly(bool enabled) { _digestOnly = enabled; }
+
+  void writeNative(const uint8_t* data1, const uint8_t* data2, int16_t x, int16_t y, int16_t w, int16_t h,
+                   bool invert = false, bool mirror_y = false, bool pgm = false) override
+  {
+    bool band = data1 && !data2 && !invert && !mirror_y && !pgm && x == 0 && w == WIDTH &&
+                y >= 0 && h > 0 && y + h <= HEIGHT && y % CALFRAME_TILE == 0 &&
+                (h % CALFRAME_TILE == 0 || y + h == HEIGHT);
+    if (band && y == 0) _rows = 0;
+    if (band && _rows == y) {
+      calFrameDigest(data1, WIDTH, h, _band);
+      if (y == 0) _next.resize(calFrameTileCount(WIDTH, HEIGHT));
+      std::copy(_band.begin(), _band.end(), _next.begin() + (y / CALFRAME_TILE) * calFrameTileCount(WIDTH, 1));
+      _rows = y + h;
+    } else {
+      _rows = -1;
+    }
+    _nextValid = _rows == HEIGHT;
+    if (_nextValid) {
+      CalFrameRect dirty;
+      size_t tiles = 0;
+      if (_compare && loadShown() && !calFrameDiff(_shown, _next, WIDTH, HEIGHT, dirty, &_ignore, &tiles)) {
+        _skipped = true;
+        return;
+      }
+      if (_shownValid) // Bildschirm-Koordinaten (Rotation 1)
+        Serial.printf("Frame-Diff: %u Kacheln, Bereich %ux%u @ %u,%u\n", (unsigned)tiles, dirty.h, dirty.w,
+                      dirty.y, (unsigned)(WIDTH - dirty.x - dirty.w));
+    }
+    if (_digestOnly) return;
+    GxEPD2_0579c_GDEY0579F51::writeNative(data1, data2, x, y, w, h, invert, mirror_y, pgm);
+  }
+
+  void refresh(bool partial_update_mode = false) override
+  {
+    if (_skipped || _digestOnly) return;
+    GxEPD2_0579c_GDEY0579F51::refresh(partial_update_mode);
+    if (_nextValid) saveShown();
+    else forgetShown();
+  }
+
+  void refresh(int16_t x, int16_t y, int16_t w, int16_t h) override
+  {
+    GxEPD2_0579c_GDEY0579F51::refresh(x, y, w, h);
+    forgetShown(); // Fenster-Refresh: Digests passen nicht mehr zum Panel
+  }
+
+private:
+  bool loadShown()
+  {
+    if (_shownValid) return true;
+    File f = SPIFFS.open(CAL_FILE_FRAME, "r");
+    if (!f) return false;
+    std::vector<uint8_t> buf(f.size());
+    bool ok = f.read(buf.data(), buf.size()) == buf.size();
+    f.close();
+    _shownValid = ok && calFrameDecode(buf.data(), buf.size(), WIDTH, HEIGHT, _shown);
+    return _shownValid;
+  }
+
+  // Erst nach abgeschlossenem Refresh: ein Abbruch davor hinterlässt höchstens veraltete Digests,
+  // und die erzwingen nur einen Refresh zu viel.
+  void saveShown()
+  {
+    _shown.swap(_next);
+    _shownValid = true;
+    _nextValid = false;
+    std::vector<uint8_t> buf;
+    calFrameEncode(_shown, WIDTH, HEIGHT, buf);
+    File f = SPIFFS.open(CAL_FILE_FRAME, "w");
+    size_t written = f ? f.write(buf.data(), buf.size()) : 0;
+    if (f) f.close();
+    if (written != buf.size()) SPIFFS.remove(CAL_FILE_FRAME);
+  }
+
+  void forgetShown()
+  {
+    _shownValid = false;
+    _shown.clear();
+    if (SPIFFS.exists(CAL_FILE_FRAME)) SPIFFS.remove(CAL_FILE_FRAME);
+  }
+
+  std::vector<uint32_t> _shown, _next, _band;
+  CalFrameRect _ignore = {0, 0, 0, 0};
+  int32_t _rows = -1; // Panel-Zeilen, die lückenlos in _next stehen (-1 = Frame unvollständig)
+  bool _shownValid = false;
+  bool _nextValid = false;
+  bool _compare = false;
+  bool _skipped = false;
+  bool _digestOnly = false;
+};
+
+#if CAL_PAGE_HEIGHT
+static_assert(CAL_PAGE_HEIGHT % CALFRAME_TILE == 0, "CAL_PAGE_HEIGHT: Bänder müssen auf Kachelgrenzen liegen");
+#endif
+static_assert(BLE_FRAME_BYTES == CalPanel::WIDTH / 4 * CalPanel::HEIGHT, "LENP: Bildgröße passt nicht zum Panel");
+// Puffer: 792 x Zeilen / 4 Bytes (voll 53.856). Im Seitenbetrieb zeichnen volle Frames in ein eigenes
+// Band (showBands); der GxEPD2-Puffer wird dann nicht mehr gezeichnet und bekommt nur eine Kachelzeile (3.168).
+static const uint16_t DISPLAY_PAGE_ROWS = CAL_PAGE_HEIGHT ? CALFRAME_TILE : CalPanel::HEIGHT;
+GxEPD2_4C<CalPanel, DISPLAY_PAGE_ROWS> display(CalPanel(EPD_CS, EPD_DC, EPD_RST, EPD_BUSY));
 
 // WiFi credentials will be loaded from /wifi.json (SPIFFS)
 
 // ====== Sleep 30 minutes ======
 static const uint64_t SLEEP_MIN = 30ULL;
+// Tageswechsel-Prüfung im Worker
+static const uint32_t CAL_ROLLOVER_CHECK_MS = 30000;
 
 RTC_DATA_ATTR char lastDate[11] = ""; // RTC memory for last date (YYYY-MM-DD)
 RTC_DATA_ATTR uint32_t lastEventsHash = 0; // Hash der angezeigten Events dieses Tages
-
-// Timeline constants
-const int TIMELINE_START_HOUR = 8;
-const int TIMELINE_END_HOUR = 18;
-const int TIMELINE_Y_START = 65;
-const int TIMELINE_Y_END = 780;
-const int TIMELINE_HEIGHT = TIMELINE_Y_END - TIMELINE_Y_START;
-const int TIMELINE_HOURS = TIMELINE_END_HOUR - TIMELINE_START_HOUR;
-const float PX_PER_HOUR = (float)TIMELINE_HEIGHT / TIMELINE_HOURS;
-
-// Helper: Convert ISO time string to Y coordinate on timeline
-int timeToY(const String &isoTime)
-{
-  int t_pos = isoTime.indexOf('T');
-  int hour = TIMELINE_START_HOUR, min = 0;
-  if (t_pos > 0 && isoTime.length() > t_pos + 5)
-  {
-    hour = isoTime.substring(t_pos + 1, t_pos + 3).toInt();
-    min = isoTime.substring(t_pos + 4, t_pos + 6).toInt();
-  }
-  return TIMELINE_Y_START + (int)(((hour - TIMELINE_START_HOUR) + min / 60.0f) * PX_PER_HOUR);
-}
+// SHA-256 der gespeicherten Kalenderdatei (Rohdaten, wie hochgeladen); len 0 = unbekannt
+struct PayloadDigest { uint32_t len; uint8_t sha[32]; };
+RTC_DATA_ATTR PayloadDigest lastPayloadDigest = {0, {0}};
+// Akku-Symbol (battLvl) der letzten Messung beim Redraw, -1 = seit Power-On nicht gemessen
+RTC_DATA_ATTR int8_t lastBatteryLevel = -1;
 
 // Helper: Compare two date strings
 bool isDateChanged(const char *current, const char *last)
@@ -293,18 +778,6 @@ String loadFile(const char *path)
   return content;
 }
 
-// Helper: Parse calendar JSON
-bool parseCalendarJson(const String &jsonStr, JsonDocument &doc)
-{
-  DeserializationError error = deserializeJson(doc, jsonStr);
-  if (error)
-  {
-    Serial.println("Fehler beim Parsen der JSON!");
-    return false;
-  }
-  return true;
-}
-
 // ==== WiFi credentials handling ====
 struct WifiCred { String ssid; String pass; };
 
@@ -377,306 +850,571 @@ String getTodayString()
   return String(today);
 }
 
-// Helper: Find today's events in calendar JSON
-struct Event
+// Sammelt während des Stream-Parsens die Events nach Tagen, je Tag kompakt als
+// Records + String-Pool (CalEventDay). Das JSON selbst wird nie als Dokument im RAM gehalten.
+struct CollectedDay
 {
-  String title;
-  String start;
-  String end;
-  String location;
-  String organizer;
-  bool isImportant;
-  bool isOnlineMeeting;
-  bool isRecurring;
-  bool isMoved;
-  bool hasAttachments;
-  bool isCanceled; // new
+  int32_t day; // lokaler Tag (CalTime::day)
+  CalEventDay events; // Payload-Reihenfolge bleibt erhalten (geht in den Events-Hash ein)
 };
 
-// FNV-1a 32-bit Hash für heutige Events (stabil, schnell, geringes Kollisionsrisiko für unseren Umfang)
-static uint32_t computeEventsHash(const std::vector<struct Event>& events) {
-  uint32_t h = 2166136261u; // FNV offset basis
-  for (auto &e : events) {
-    String line = e.start + "|" + e.end + "|" + e.title + "|" + e.location + "|" + e.organizer + "|" +
-                  (e.isCanceled?"C":"-") + (e.isOnlineMeeting?"O":"-") + (e.isRecurring?"R":"-") + (e.isImportant?"I":"-");
-    const char* p = line.c_str();
-    while (*p) { h ^= (uint8_t)*p++; h *= 16777619u; }
-    // Feldtrenner zwischen Events, damit (AB|C)(D) != (A)(B|CD)
-    h ^= (uint8_t)'\n'; h *= 16777619u;
-  }
-  return h;
-}
+struct DayCollector
+{
+  char today[11];
+  int32_t todayDay; // nur gültig, wenn today gesetzt ist
+  std::vector<CollectedDay> days; // heute + alle übrigen Tage (für den Tages-Cache, saveDayCache)
+  CalBinSetHash setHash; // über alle Events, Basis für Delta-Uploads
+};
 
-std::vector<Event> findTodaysEvents(JsonArray events, const String &today)
+// JSON wird gestreamt geparst, CalBin erst am Ende aus dem Buffer dekodiert
+enum CalPayloadKind : uint8_t { PAYLOAD_UNKNOWN, PAYLOAD_JSON, PAYLOAD_BIN };
+
+static CalStream calParser;
+static DayCollector calCollector;
+static CalPayloadKind calPayloadKind = PAYLOAD_UNKNOWN;
+static bool calStreamOk = false;
+static uint32_t calStoreSetHash = 0; // Set-Hash der gespeicherten Kalenderdaten (0 = unbekannt)
+
+static CollectedDay *findCollectedDay(DayCollector *c, int32_t day)
 {
-  std::vector<Event> todaysEvents;
-  for (JsonObject evt : events)
-  {
-    const char *start = evt["start"];
-    const char *end = evt["end"];
-    String title = evt["summary"] | evt["subject"] | "(kein Titel)";
-    String location = evt["location"] | "";
-    if (location.startsWith("; ")) // truncate long URLs
-      location = location.substring(2, location.length() - 2);
-    // Perform replacements separately (String::replace returns void)
-    location.replace("DE-", "");
-    location.replace("HB-", "");
-    location.replace("COC-", "");
-    String organizer = evt["organizer"] | "";
-    String startStr = String(start);
-    String endStr = String(end);
-    bool isImportant = evt["importance"] == "high" | false;
-    bool isOnlineMeeting = evt["isOnlineMeeting"] | false;
-    bool isRecurring = evt["isRecurring"] | false;
-    bool isMoved = evt["isMoved"] | false;
-    bool hasAttachments = evt["hasAttachments"] | false;
-    const char* status = evt["status"] | evt["eventStatus"] | ""; // try multiple keys
-    bool isCanceled = evt["isCancelled"] | false;
-    if (strncmp(start, today.c_str(), 10) == 0)
-    {
-      todaysEvents.push_back({title, startStr, endStr, location, organizer, isImportant, isOnlineMeeting, isRecurring, isMoved, hasAttachments, isCanceled});
-    }
-  }
-  return todaysEvents;
+  // rückwärts: Events kommen meist nach Datum sortiert
+  for (size_t i = c->days.size(); i-- > 0;)
+    if (c->days[i].day == day) return &c->days[i];
+  return nullptr;
 }
 
-// Helper: Draw timeline axis
-void drawTimelineAxis()
+static void collectEvent(const CalStreamEvent &evt, void *ctx)
 {
-  for (int h = TIMELINE_START_HOUR; h <= TIMELINE_END_HOUR; h++)
-  {
-    int y = TIMELINE_Y_START + (int)((h - TIMELINE_START_HOUR) * PX_PER_HOUR);
-    display.setFont(&FreeSans6pt7b);
-    display.setCursor(0, y + 5);
-    char buf[6];
-    sprintf(buf, "%02d", h);
-    display.print(buf);
-    display.drawLine(17, y, display.width(), y, GxEPD_DARKGREY);
-  }
-}
-
-// Helper: Draw events using external layout engine
-// simple helper: wrap text within width using current font, returns y after drawing
-int drawWrapped(int x, int y, int w, const String &text, int maxLines, int lineAdvance) {
-  int line = 0;
-  int cursorX = x; int cursorY = y;
-  String current;
-  int lastBreakPos = -1;
-  for (int i = 0; i < (int)text.length(); ++i) {
-    char c = text[i];
-    if (c == '\n') {
-      display.setCursor(cursorX, cursorY);
-      display.print(current);
-      current = ""; cursorY += lineAdvance; line++; if (line>=maxLines) return cursorY; continue;
-    }
-    current += c;
-    int16_t bx, by; uint16_t bw,bh; display.getTextBounds(current, 0,0,&bx,&by,&bw,&bh);
-    if (bw > (uint16_t)w) {
-      // emit previous word
-      int cutPos = current.lastIndexOf(' ');
-      if (cutPos <= 0) cutPos = current.length()-1; // force cut
-      String out = current.substring(0, cutPos);
-      if (out.length()==0) out = current.substring(0, current.length()-1);
-      display.setCursor(cursorX, cursorY);
-      display.print(out);
-      cursorY += lineAdvance; line++; if (line>=maxLines) return cursorY;
-      current = current.substring(cutPos); current.trim();
-    }
+  DayCollector *c = (DayCollector *)ctx;
+  if (!evt.start[0])
+    return;
+  c->setHash.add(calBinEventId(evt), calBinEventHash(evt));
+  if (!evt.hasStartTime)
+    return; // Startzeit nicht lesbar: keinem Tag zuzuordnen
+  // ab hier nur noch die beim Einlesen aufgelösten Zeiten (CalTime), keine ISO-Strings mehr
+  CollectedDay *day = findCollectedDay(c, evt.startTime.day);
+  if (!day) {
+    c->days.emplace_back();
+    day = &c->days.back();
+    day->day = evt.startTime.day;
   }
-  if (current.length()) { display.setCursor(cursorX, cursorY); display.print(current); cursorY += lineAdvance; }
-  return cursorY;
+  char location[CALSTREAM_LOCATION_LEN];
+  calEventDisplayLocation(evt.location, location, sizeof(location));
+  uint16_t endMin = evt.hasEndTime ? calEventEndMin(evt.startTime, evt.endTime) : 0;
+  if (!day->events.add(evt.startTime.minutes, endMin, calBinFlags(evt),
+                       evt.hasTitle ? evt.title : CALEVENT_NO_TITLE, evt.organizer, location))
+    Serial.printf("Zu viele Texte am %.10s – Event übersprungen.\n", evt.start);
 }
 
-// minutes->Y helper for segments
-int minutesToY(int minutesFromMidnight)
+void beginCalendarStream()
 {
-  int hour = minutesFromMidnight / 60;
-  int min = minutesFromMidnight % 60;
-  float rel = ((hour - TIMELINE_START_HOUR) + min / 60.0f);
-  return TIMELINE_Y_START + (int)(rel * PX_PER_HOUR);
+  String today = getTodayString();
+  strncpy(calCollector.today, today.c_str(), sizeof(calCollector.today));
+  calCollector.today[sizeof(calCollector.today) - 1] = '\0';
+  if (!calTimeParseDay(calCollector.today, calCollector.todayDay))
+    calCollector.today[0] = '\0';
+  calCollector.days.clear();
+  calCollector.setHash = CalBinSetHash();
+  calParser.begin(collectEvent, &calCollector);
+  calPayloadKind = PAYLOAD_UNKNOWN;
+  calStreamOk = false;
 }
 
-void drawEvents(const std::vector<Event> &events)
+void feedCalendarStream(const char *data, size_t len)
 {
-  display.setFont(&FreeSansBold7pt7b);  
-  display.setTextColor(GxEPD_BLACK);
+  if (!len) return;
+  if (calPayloadKind == PAYLOAD_UNKNOWN)
+    calPayloadKind = (data[0] == CALBIN_MAGIC[0]) ? PAYLOAD_BIN : PAYLOAD_JSON;
+  if (calPayloadKind == PAYLOAD_JSON)
+    calParser.feed(data, len);
+}
 
-  if (events.empty()) {
-    display.setCursor(50, TIMELINE_Y_START + 20);
-    display.print("Keine Termine heute.");
-    return;
+// Schließt das Parsen ab; `payload` wird nur für CalBin gebraucht (komplett im Speicher)
+bool endCalendarStream(const char *payload, size_t len)
+{
+  size_t count = 0;
+  if (calPayloadKind == PAYLOAD_BIN) {
+    calStreamOk = calBinDecode((const uint8_t *)payload, len, collectEvent, &calCollector, &count);
+  } else {
+    calStreamOk = calParser.finish();
+    count = calParser.eventCount();
   }
-  std::vector<CalLayoutInput> inputs; inputs.reserve(events.size());
-  for (auto &e : events) inputs.push_back({e.start, e.end});
-  auto boxes = computeCalendarLayout(inputs);
-
-  const int xBase = 20;
-  const int innerWidth = 248;
-  const int gap = 4;
-
-  for (auto &box : boxes) {
-    const Event &evt = events[box.eventIndex];
-    int yStart = timeToY(evt.start);
-    int yEnd = timeToY(box.effectiveEnd);
-    if (yEnd <= yStart)
-      yEnd = yStart + 22;
-    int box_w;
-    if (box.groupColumns == 2) box_w = (innerWidth - gap)/2; else box_w = (innerWidth - gap*(box.groupColumns-1)) / box.groupColumns;
-    int span = max(1, box.colSpan);
-    int box_x = xBase + box.column * (box_w + gap);
-    int box_total_w = box_w * span + gap * (span - 1);
-    int box_y = yStart + 1;
-    int box_h = max(22, yEnd - yStart - 2);
-
-    // Cancelled style: white fill, yellow border; else yellow fill
-    if (evt.isCanceled) {
-      display.setFont(&FreeSans7pt7b);
-      display.fillRect(box_x, box_y, box_total_w, box_h, GxEPD_WHITE);
-      display.drawRect(box_x, box_y, box_total_w, box_h, GxEPD_YELLOW);
-    } else {
-      display.setFont(&FreeSansBold7pt7b);
-      display.fillRect(box_x, box_y, box_total_w, box_h, GxEPD_YELLOW);
-    }
+  if (calStreamOk)
+    calStoreSetHash = calCollector.setHash.value();
+  else
+    Serial.printf("Fehler beim Parsen der Kalenderdaten (%s, %u Events gelesen)!\n",
+                  calPayloadKind == PAYLOAD_BIN ? "CalBin" : "JSON", (unsigned)count);
+  return calStreamOk;
+}
 
-    int textLeft = box_x + 4;
-    int textWidth = box_total_w - 8;
-    int cursorY = box_y + 12;
-    cursorY = drawWrapped(textLeft, cursorY, textWidth, evt.title, 2, 14);
-    display.setFont(&Font5x7Fixed);
-    cursorY = drawWrapped(textLeft, cursorY, textWidth, evt.organizer, 1, 12);
-    drawWrapped(textLeft, cursorY, textWidth, evt.location, 1, 12);
-
-    int iconX = box_x + box_w - 14;
-    if (evt.isRecurring) {
-      if (evt.isMoved)
-        display.drawBitmap(iconX, box_y + 1, epd_bitmap_series_mov, 13, 12, GxEPD_BLACK);
-      else
-        display.drawBitmap(iconX, box_y + 1, epd_bitmap_series, 12, 12, GxEPD_BLACK);
-    }
-    if (evt.isOnlineMeeting)
-      display.drawBitmap(iconX, box_y + box_h - 12, epd_bitmap_Teams, 12, 12, GxEPD_BLACK);
-    if (evt.hasAttachments)
-      display.drawBitmap(iconX - 10, box_y + 2, epd_bitmap_attachment, 10, 12, GxEPD_BLACK);
-    if (evt.isImportant)
-      display.drawBitmap(box_x + 1, box_y + 5, epd_bitmap_important, 6, 11, GxEPD_RED);
+// Akku-Füllstand für das Symbol im Kopf (battLvl, 0..11)
+static int readBatteryLevel() {
+  uint32_t Vbatt = 0;
+  for(int i = 0; i < 16; i++) {
+    Vbatt = Vbatt + analogReadMilliVolts(A0); // ADC with correction   
   }
+  float Vbattf = 2 * Vbatt / 16 / 1000.0;     // attenuation ratio 1/2, mV --> V
+  Serial.println(Vbattf, 3);
+  return battLvl(Vbattf);
 }
 
-// Draw update time at bottom right using 4x5 fixed font
-void drawUpdateTimestamp() {
+// Kopfzeile und Uhrzeit aus der Systemzeit (leer ohne Zeit), Akkustand über den ADC (für den Status gemerkt)
+static void readHeaderInfo(char *weekday, size_t weekdayLen, char *date, size_t dateLen, char *stamp, size_t stampLen, int &battery) {
   struct tm ti;
-  if (!getLocalTime(&ti))
-    return;
-  char buf[6];
-  snprintf(buf, sizeof(buf), "%02d:%02d", ti.tm_hour, ti.tm_min);
-  display.setFont(&Font4x5Fixed);
-  int16_t x1, y1;
-  uint16_t w, h;
-  display.getTextBounds(buf, 0, 0, &x1, &y1, &w, &h);
-  int x = display.width() - w - 4;
-  int y = display.height() - 4; // baseline near bottom
-  display.setTextColor(GxEPD_DARKGREY);
-  display.setCursor(x, y);
-  display.print(buf);
-}
-
-void getGermanDateHeader(String &weekdayOut, String &dateOut)
-{
-  static const char *WEEKDAY_DE[7] = {"Sonntag", "Montag", "Dienstag", "Mittwoch", "Donnerstag", "Freitag", "Samstag"};
-  static const char *MONTH_DE[12] = {"Januar", "Februar", "März", "April", "Mai", "Juni", "Juli", "August", "September", "Oktober", "November", "Dezember"};
-  struct tm timeinfo;
-  if (!getLocalTime(&timeinfo))
-  {
-    weekdayOut = "";
-    dateOut = "";
-    return;
+  weekday[0] = date[0] = stamp[0] = '\0';
+  if (getLocalTime(&ti)) {
+    calRenderDateHeader(ti, weekday, weekdayLen, date, dateLen);
+    snprintf(stamp, stampLen, "%02d:%02d", ti.tm_hour, ti.tm_min);
   }
-  int w = timeinfo.tm_wday;
-  if (w < 0 || w > 6)
-    w = 0;
-  int m = timeinfo.tm_mon;
-  if (m < 0 || m > 11)
-    m = 0;
-  weekdayOut = WEEKDAY_DE[w];
-  // Some fonts may lack umlauts; optional fallback if needed
-  // if (weekdayOut.indexOf("ä") >= 0) { /* keep it; font likely supports */ }
-  dateOut = String(timeinfo.tm_mday) + ". " + MONTH_DE[m];
-}
-
-int battLvl(int Vbattf) {
-  if (Vbattf > 4.2) return 11;
-  if (Vbattf > 4.1) return 10;
-  if (Vbattf > 4) return 9;
-  if (Vbattf > 3.95) return 8;
-  if (Vbattf > 3.90) return 7;
-  if (Vbattf > 3.80) return 6;
-  if (Vbattf > 3.70) return 5;
-  if (Vbattf > 3.60) return 4;
-  if (Vbattf > 3.50) return 3;
-  if (Vbattf > 3.40) return 2;
-  if (Vbattf > 3.30) return 1;
-  return 0;
+  battery = lastBatteryLevel = (int8_t)readBatteryLevel();
 }
 
-// Extrahierter Anzeige-Update-Code (aus setup)
-bool updateCalendarFromJson(const String& jsonStr, bool forceRefresh) {
-  Serial.println("Kalender-Update von JSON...");
-
-  if (jsonStr.isEmpty()) return false;
-  JsonDocument doc;
-  if (!parseCalendarJson(jsonStr, doc)) return false;
-  String today = getTodayString();
-  if (today.isEmpty()) return false;
-
-  bool dateChanged = isDateChanged(today.c_str(), lastDate);
-
-  // Events extrahieren (aber erst Hash bilden, dann ggf. abbrechen)
-  JsonArray events = doc.as<JsonArray>();
-  std::vector<Event> todaysEvents = findTodaysEvents(events, today);
-
-  uint32_t newHash = computeEventsHash(todaysEvents);
+// Redraw nur bei neuem Datum, geändertem Events-Hash oder Force; übernimmt dann Datum und Hash
+static bool calendarNeedsRedraw(const char* today, uint32_t newHash, size_t eventCount, bool forceRefresh) {
+  bool dateChanged = isDateChanged(today, lastDate);
   #if CAL_HASH_DEBUG
     Serial.printf("Hash Check: date=%s events=%u new=0x%08lX prev=0x%08lX force=%d dateChanged=%d\n",
-                  today.c_str(), (unsigned)todaysEvents.size(), (unsigned long)newHash, (unsigned long)lastEventsHash,
+                  today, (unsigned)eventCount, (unsigned long)newHash, (unsigned long)lastEventsHash,
                   (int)forceRefresh, (int)dateChanged);
   #endif
   if (!forceRefresh && !dateChanged && newHash == lastEventsHash) {
     Serial.println("Unverändert (Datum & Events-Hash) – kein Redraw.");
-    return true;
+    return false;
   }
-  strncpy(lastDate, today.c_str(), sizeof(lastDate));
+  strncpy(lastDate, today, sizeof(lastDate));
   lastEventsHash = newHash;
+  return true;
+}
 
-  display.setRotation(1);
-  display.fillScreen(GxEPD_WHITE);
-
-  String wday, dateLine;
-  getGermanDateHeader(wday, dateLine);
-  int headerH = 56;
-  display.fillRect(0, 0, display.width(), headerH, GxEPD_RED);
-  display.setTextColor(GxEPD_WHITE);
-  display.setFont(&FreeSansBold12pt7b);
-  display.setCursor(10, 22); display.print(wday);
-  display.setCursor(10, 46); display.print(dateLine);
-
-  // Status-Icons (optional unverändert) 
-  uint32_t Vbatt = 0;
-  for(int i = 0; i < 16; i++) {
-    Vbatt = Vbatt + analogReadMilliVolts(A0); // ADC with correction   
+#if CAL_PAGE_HEIGHT
+// Voller Frame im Seitenbetrieb: je CAL_PAGE_HEIGHT Panel-Zeilen ein Band (CalBand), das als Kopie der
+// statischen Ebene aus dem Flash beginnt (CAL_BACKGROUND, memcpy je Zeile); darauf wird nur die
+// Display-Liste mit den dynamischen Teilen gespielt. Bänder sind bei Rotation 1 senkrechte Streifen,
+// Ops außerhalb werden übersprungen. Übertragung und Refresh wie bei GxEPD2 nextPage().
+static void showBands(const CalDisplayList &list) {
+  std::vector<uint8_t> buffer(CalPanel::WIDTH / 4 * CAL_PAGE_HEIGHT);
+  CalBand band(CalPanel::WIDTH, CalPanel::HEIGHT, buffer.data(), CAL_PAGE_HEIGHT);
+  band.setRotation(display.getRotation());
+  for (uint16_t row = 0; row < CalPanel::HEIGHT; row += CAL_PAGE_HEIGHT) {
+    band.begin(row, &CAL_BACKGROUND);
+    int16_t x, y, w, h;
+    band.screenRect(x, y, w, h);
+    list.replay(band, x, y, w, h);
+    display.epd2.writeNative(band.buffer(), nullptr, 0, row, CalPanel::WIDTH, band.rows());
   }
-  float Vbattf = 2 * Vbatt / 16 / 1000.0;     // attenuation ratio 1/2, mV --> V
-  Serial.println(Vbattf, 3);
-  display.drawBitmap(270 - 18, 6, epd_bitmap_batt, 16, 9, GxEPD_WHITE);
-  display.fillRect(270 - 18 + 2, 8, battLvl(Vbattf), 5, GxEPD_WHITE);
+  display.epd2.refresh(false);
+  display.epd2.powerOff();
+}
+#endif
 
-  display.drawBitmap(270 - 18 - 16, 3, epd_bitmap_bt, 11, 12, GxEPD_WHITE);
+// Zeichnet in den ganzen Puffer bzw. (CAL_PAGE_HEIGHT) einmal die dynamischen Teile in eine Display-
+// Liste, die für jedes Band über der statischen Ebene abgespielt wird; Akku-Messung, Umbruch und
+// Layout laufen so nur einmal.
+// Zum Panel geht ein voller 4-Farb-Refresh (der GDEY0579F51 kann keinen Teil-Refresh) – außer der
+// Frame ist bis auf die Uhrzeit pixelgleich mit dem angezeigten (CalPanel).
+void drawCalendar(const CalEventDay& todaysEvents, const std::vector<CalLayoutBox>& boxes, bool forceRefresh) {
+  display.setRotation(1);
+#if CAL_PAGE_HEIGHT
+  CalDisplayList list(display.width(), display.height());
+  list.reserve(4096);
+  Adafruit_GFX &gfx = list;
+#else
+  Adafruit_GFX &gfx = display;
+#endif
 
-  display.setTextColor(GxEPD_BLACK);
-  drawTimelineAxis();
-  drawEvents(todaysEvents);
-  drawUpdateTimestamp();
+  char weekday[12], date[20], hhmm[6];
+  CalRenderInfo info = {weekday, date, 0, hhmm, nullptr, nullptr, CAL_PAGE_HEIGHT != 0};
+  readHeaderInfo(weekday, sizeof(weekday), date, sizeof(date), hhmm, sizeof(hhmm), info.battery);
+  EpdRect stamp = calRenderFrame(gfx, info, todaysEvents, boxes);
+  display.epd2.compareNextFrame(!forceRefresh, stamp.x, stamp.y, stamp.w, stamp.h);
+#if CAL_PAGE_HEIGHT
+  // Seiten gehen sofort zum Panel: erst ein Durchlauf nur für die Digests, dann ggf. der echte
+  if (!forceRefresh) {
+    display.epd2.digestOnly(true);
+    showBands(list);
+    display.epd2.digestOnly(false);
+  }
+  if (!display.epd2.lastFrameSkipped()) {
+    display.epd2.compareNextFrame(false);
+    showBands(list);
+  }
+#else
   display.display(true);
-  Serial.println("Display aktualisiert (Kalender).");
+#endif
+  if (display.epd2.lastFrameSkipped()) {
+    Serial.println("Frame pixelgleich (bis auf die Uhrzeit) – kein Refresh.");
+  } else {
+    Serial.println("Display aktualisiert (Kalender).");
+  }
+#if CAL_PAGE_HEIGHT
+  Serial.printf("Display-Liste: %u Ops, %u Bytes, %u Bänder à %u Zeilen.\n", (unsigned)list.count(),
+                (unsigned)list.bytes(), (unsigned)((CalPanel::HEIGHT + CAL_PAGE_HEIGHT - 1) / CAL_PAGE_HEIGHT),
+                (unsigned)CAL_PAGE_HEIGHT);
+#endif
+  Serial.printf("Heap: frei %u, Minimum seit Boot %u Bytes.\n", (unsigned)ESP.getFreeHeap(), (unsigned)ESP.getMinFreeHeap());
+}
+
+// LENP: vom Host fertig gerendertes Bild (CalRender, native Panel-Zeilen) als ein Band voller Höhe
+// zum Panel; CalPanel überspringt Übertragung und Refresh, wenn es pixelgleich mit dem angezeigten ist.
+// Status und Redraw-Entscheidung sehen danach die Events des Bilds (`eventsHash` vom Host). Der Digest
+// der Kalenderdatei wird vergessen (wie bei saveCalendarFile): die Anzeige stammt nicht mehr aus ihr,
+// ein byte-gleicher Upload läuft danach wieder durch Parser und Redraw-Entscheidung. Beim Tageswechsel
+// zeichnet das Gerät wieder selbst aus der gespeicherten Kalenderdatei.
+void showPanelFrame(const uint8_t* frame, uint32_t eventsHash, bool forceRefresh) {
+  display.epd2.compareNextFrame(!forceRefresh);
+  display.epd2.writeNative(frame, nullptr, 0, 0, CalPanel::WIDTH, CalPanel::HEIGHT);
+  display.epd2.refresh(false);
+  display.epd2.powerOff();
+  if (display.epd2.lastFrameSkipped()) {
+    Serial.println("Host-Bild pixelgleich mit der Anzeige – kein Refresh.");
+  } else {
+    Serial.println("Display aktualisiert (Host-Bild).");
+  }
+  if (time(nullptr) >= 1600000000) { // sonst würde getLocalTime warten
+    String today = getTodayString();
+    if (!today.isEmpty()) strncpy(lastDate, today.c_str(), sizeof(lastDate));
+  }
+  lastEventsHash = eventsHash;
+  rememberPayloadDigest(nullptr, 0);
+  bleUpdateStatus();
+}
+
+// Extrahierter Anzeige-Update-Code (aus setup)
+bool updateCalendarFromEvents(const CalEventDay& todaysEvents, const char* today, bool forceRefresh) {
+  Serial.println("Kalender-Update...");
+  if (calendarNeedsRedraw(today, todaysEvents.hash(), todaysEvents.size(), forceRefresh))
+    drawCalendar(todaysEvents, computeCalendarLayout(todaysEvents), forceRefresh);
+  return true;
+}
+
+// Status-Characteristic: Host vergleicht vor dem Upload und überspringt ihn bei gleichem Stand.
+// events = CalEventDay::hash() der angezeigten Events von `date`, payload = Set-Hash aller gespeicherten Events,
+// batt = Akku-Symbol (battLvl) vom letzten Redraw, damit ein auf dem Host gerendertes Bild (LENP:) denselben
+// Kopf zeigt; gemessen wird hier nur, solange es noch keinen Redraw gab
+void bleUpdateStatus() {
+  if (!bleStatusChr) return;
+  if (lastBatteryLevel < 0) lastBatteryLevel = (int8_t)readBatteryLevel();
+  char status[96];
+  int n = snprintf(status, sizeof(status), "proto=2;date=%s;events=%08lx;payload=%08lx;caps=%s;batt=%d",
+                   lastDate, (unsigned long)lastEventsHash, (unsigned long)calStoreSetHash, BLE_CAPABILITIES,
+                   (int)lastBatteryLevel);
+  bleStatusChr->setValue((const uint8_t*)status, min((size_t)n, sizeof(status) - 1));
+}
+
+// Zeichnet nach abgeschlossenem Parse-Vorgang ggf. neu (endCalendarStream vorher aufrufen)
+bool finishCalendarStream(bool forceRefresh) {
+  bool ok = calStreamOk && calCollector.today[0];
+  if (ok) {
+    static const CalEventDay noEvents;
+    const CollectedDay *day = findCollectedDay(&calCollector, calCollector.todayDay);
+    ok = updateCalendarFromEvents(day ? day->events : noEvents, calCollector.today, forceRefresh);
+  }
+  std::vector<CollectedDay>().swap(calCollector.days); // Speicher sofort freigeben
+  bleUpdateStatus();
+  return ok;
+}
+
+// Digest der gespeicherten Kalenderdatei merken (RTC + /calendar.sha); nullptr vergisst ihn.
+// Die Datei liegt nur neben einer vollständig geschriebenen Kalenderdatei.
+void rememberPayloadDigest(const uint8_t* sha, size_t len) {
+  if (!sha) {
+    lastPayloadDigest.len = 0;
+    if (SPIFFS.exists(CAL_FILE_DIGEST)) SPIFFS.remove(CAL_FILE_DIGEST);
+    return;
+  }
+  lastPayloadDigest.len = (uint32_t)len;
+  memcpy(lastPayloadDigest.sha, sha, sizeof(lastPayloadDigest.sha));
+  File f = SPIFFS.open(CAL_FILE_DIGEST, "w");
+  size_t written = f ? f.write((const uint8_t*)&lastPayloadDigest, sizeof(lastPayloadDigest)) : 0;
+  if (f) f.close();
+  if (written != sizeof(lastPayloadDigest)) SPIFFS.remove(CAL_FILE_DIGEST);
+}
+
+// Nach einem Power-On ist der RTC-Wert leer: aus /calendar.sha übernehmen
+static void loadPayloadDigest() {
+  if (lastPayloadDigest.len) return;
+  File f = SPIFFS.open(CAL_FILE_DIGEST, "r");
+  if (!f) return;
+  PayloadDigest d;
+  if (f.read((uint8_t*)&d, sizeof(d)) == sizeof(d) && f.size() == sizeof(d)) lastPayloadDigest = d;
+  f.close();
+}
+
+// Beim LEN-Header: gleiche Rohlänge wie die gespeicherte Datei, gleiches Datum, kein LENF: –
+// dann lohnt es sich, das Parsen bis zum Digest-Vergleich zurückzustellen
+bool calPayloadMaybeUnchanged(size_t rawLen) {
+  return !bleForceOnFinish && lastPayloadDigest.len && lastPayloadDigest.len == rawLen &&
+         calCollector.today[0] && !isDateChanged(calCollector.today, lastDate);
+}
+
+bool calPayloadUnchanged(const uint8_t* sha, size_t len) {
+  return lastPayloadDigest.len == len && memcmp(lastPayloadDigest.sha, sha, sizeof(lastPayloadDigest.sha)) == 0;
+}
+
+// Tages-Cache schreiben: je Tag Layout und Redraw-Hash vorab berechnen.
+// Ein Tageswechsel (oder Boot) liest danach nur noch einen Datensatz.
+void saveDayCache() {
+  if (!calStreamOk) return;
+  std::vector<CollectedDay> &days = calCollector.days;
+  std::sort(days.begin(), days.end(), [](const CollectedDay &a, const CollectedDay &b) {
+    return a.day < b.day;
+  });
+  CalDaysWriter writer;
+  writer.begin(calStoreSetHash);
+  bool ok = true;
+  char date[11];
+  for (size_t i = 0; ok && i < days.size(); i++) {
+    if (days[i].events.empty()) continue;
+    calTimeFormatDay(days[i].day, date, sizeof(date));
+    ok = writer.addDay(date, days[i].events, computeCalendarLayout(days[i].events));
+  }
+  if (!ok) {
+    Serial.println("Tages-Cache nicht erstellt (ungültiges Datum oder zu groß).");
+    return;
+  }
+  std::vector<uint8_t> buf;
+  writer.finish(buf);
+  File f = SPIFFS.open(CAL_FILE_DAYS, "w");
+  size_t written = f ? f.write(buf.data(), buf.size()) : 0;
+  if (f) f.close();
+  if (written != buf.size()) {
+    Serial.println("Tages-Cache speichern fehlgeschlagen!");
+    SPIFFS.remove(CAL_FILE_DAYS);
+    return;
+  }
+  Serial.printf("Tages-Cache gespeichert: %u Tage, %u Bytes.\n", (unsigned)writer.dayCount(), (unsigned)buf.size());
+}
+
+// Heutigen Tag aus dem Tages-Cache zeichnen: Header + Index lesen, einen Datensatz laden –
+// kein Parsen, kein Layout. Fehlt der Tag im Index, hat er keine Termine.
+bool updateCalendarFromDayCache(bool forceRefresh) {
+  File f = SPIFFS.open(CAL_FILE_DAYS, "r");
+  if (!f) return false;
+  String today = getTodayString();
+  if (today.isEmpty()) {
+    f.close();
+    return false;
+  }
+  uint8_t head[CALDAYS_HEADER_SIZE];
+  CalDaysHeader hdr;
+  if (f.read(head, sizeof(head)) != sizeof(head) || !calDaysReadHeader(head, sizeof(head), hdr)) {
+    f.close();
+    Serial.println("Tages-Cache ungültig (z.B. altes Format) – verworfen.");
+    SPIFFS.remove(CAL_FILE_DAYS); // wird beim nächsten Parsen der Kalenderdatei neu erstellt
+    return false;
+  }
+  std::vector<uint8_t> buf(calDaysIndexSize(hdr));
+  CalDaysIndexEntry day = {};
+  bool ok = f.read(buf.data(), buf.size()) == buf.size();
+  bool found = ok && calDaysFind(buf.data(), buf.size(), hdr, today.c_str(), day);
+  if (found) {
+    buf.resize(day.length);
+    ok = f.seek(day.offset) && f.read(buf.data(), buf.size()) == buf.size();
+  }
+  f.close();
+  CalEventDay events;
+  std::vector<CalLayoutBox> boxes;
+  if (ok && found) ok = calDaysDecodeDay(buf.data(), buf.size(), events, boxes);
+  if (!ok) {
+    Serial.println("Tages-Cache defekt – verworfen.");
+    SPIFFS.remove(CAL_FILE_DAYS);
+    return false;
+  }
+  calStoreSetHash = hdr.setHash;
+  Serial.printf("Kalender-Update (Tages-Cache, %u Events)...\n", (unsigned)events.size());
+  uint32_t hash = found ? day.eventsHash : events.hash();
+  if (calendarNeedsRedraw(today.c_str(), hash, events.size(), forceRefresh))
+    drawCalendar(events, boxes, forceRefresh);
+  bleUpdateStatus();
+  return true;
+}
+
+// Läuft im Worker: neuer Tag -> aus dem Tages-Cache zeichnen (Fallback: Kalenderdatei parsen)
+void calCheckDayRollover() {
+  static unsigned long lastCheck = 0;
+  if (bleTransferActive || millis() - lastCheck < CAL_ROLLOVER_CHECK_MS) return;
+  lastCheck = millis();
+  if (time(nullptr) < 1600000000) return; // Zeit noch nicht gesetzt (getLocalTime würde warten)
+  String today = getTodayString();
+  if (today.isEmpty() || !isDateChanged(today.c_str(), lastDate)) return;
+  if (!SPIFFS.exists(CAL_FILE_DAYS) && !SPIFFS.exists(CAL_FILE_BIN) && !SPIFFS.exists(CAL_FILE_JSON)) return;
+  Serial.printf("Tageswechsel: %s -> %s\n", lastDate[0] ? lastDate : "-", today.c_str());
+  if (!updateCalendarFromDayCache(false)) updateCalendarFromFile(false);
+}
+
+// Gespeicherte Kalenderdaten laden: CalBin am Stück in die Empfangs-Arena, JSON blockweise gestreamt
+bool updateCalendarFromFile(bool forceRefresh) {
+  bool binary = SPIFFS.exists(CAL_FILE_BIN);
+  const char* path = binary ? CAL_FILE_BIN : CAL_FILE_JSON;
+  File file = SPIFFS.open(path, "r");
+  if (!file) {
+    Serial.printf("Datei %s nicht gefunden!\n", path);
+    return false;
+  }
+  beginCalendarStream();
+  if (binary) {
+    // Läuft nie während eines Transfers (Boot bzw. Worker): die Empfangs-Arena ist frei
+    size_t len = file.size();
+    if (len > BLE_MAX_PAYLOAD) {
+      Serial.printf("%s mit %u Bytes größer als die Arena (%u) – ignoriert.\n", path, (unsigned)len,
+                    (unsigned)BLE_MAX_PAYLOAD);
+      file.close();
+      return false;
+    }
+    size_t n = file.read((uint8_t*)bleArena, len);
+    file.close();
+    feedCalendarStream(bleArena, n);
+    endCalendarStream(bleArena, n);
+  } else {
+    char block[256];
+    while (file.available()) {
+      size_t n = file.read((uint8_t*)block, sizeof(block));
+      if (n == 0) break;
+      feedCalendarStream(block, n);
+    }
+    file.close();
+    endCalendarStream(nullptr, 0);
+  }
+  if (!SPIFFS.exists(CAL_FILE_DAYS)) saveDayCache(); // z.B. nach einem Firmware-Update
+  return finishCalendarStream(forceRefresh);
+}
+
+#if CAL_HEAP_SELFTEST
+// Schickt die gespeicherte Kalenderdatei 1000x wie ein Upload durch den Empfangspfad: Header,
+// MTU-große Stücke per bleIngest in die Arena (SHA und Parser laufen mit), Abschluss wie in
+// calHandleChunk. Nur saveCalendarFile entfällt; die Anzeige bleibt (gleicher Events-Hash)
+// unverändert. Fragmentiert der Pfad den Heap, schrumpft der größte freie Block von Durchlauf
+// zu Durchlauf – dann bricht der Test per assert ab.
+static void calHeapSelfTest() {
+  const int UPLOADS = 1000;
+  const size_t CHUNK = 244; // MTU 247 - 3
+  File file = SPIFFS.open(SPIFFS.exists(CAL_FILE_BIN) ? CAL_FILE_BIN : CAL_FILE_JSON, "r");
+  if (!file || file.size() == 0 || file.size() > BLE_MAX_PAYLOAD) {
+    Serial.println("Heap-Selbsttest: keine passende Kalender-Datei.");
+    if (file) file.close();
+    return;
+  }
+  std::vector<char> payload(file.size()); // vor Durchlauf 0, zählt zur Grundlinie
+  file.read((uint8_t*)payload.data(), payload.size());
+  file.close();
+  char header[24];
+  int headerLen = snprintf(header, sizeof(header), "LEN:%u", (unsigned)payload.size());
+  size_t first = 0, lowest = SIZE_MAX, highest = 0;
+  for (int i = 0; i <= UPLOADS; ++i) {
+    CalTransferHeader hdr;
+    if (!calParseTransferHeader(header, headerLen, hdr)) break;
+    bleResetTransfer();
+    bleExpectedLen = hdr.wireLength;
+    bleRawLen = hdr.rawLength;
+    beginCalendarStream();
+    mbedtls_sha256_starts(&bleSha, 0);
+    for (size_t off = 0; off < payload.size(); off += CHUNK)
+      bleIngest((const uint8_t*)payload.data() + off, min(CHUNK, payload.size() - off));
+    uint8_t sha[32];
+    mbedtls_sha256_finish(&bleSha, sha);
+    if (!endCalendarStream(bleArena, bleRawPos) || !finishCalendarStream(false)) {
+      Serial.printf("Heap-Selbsttest: Durchlauf %d nicht geparst – abgebrochen.\n", i);
+      bleResetTransfer();
+      return;
+    }
+    bleResetTransfer();
+    size_t largest = heap_caps_get_largest_free_block(MALLOC_CAP_8BIT);
+    if (i == 0) { first = largest; continue; } // Durchlauf 0: einmalige Allokationen
+    lowest = min(lowest, largest);
+    highest = max(highest, largest);
+    if (i % 100 == 0)
+      Serial.printf("Heap-Selbsttest %4d: frei %u, größter Block %u, min frei %u\n", i,
+                    (unsigned)ESP.getFreeHeap(), (unsigned)largest, (unsigned)ESP.getMinFreeHeap());
+  }
+  bool stable = lowest + 1024 >= first;
+  Serial.printf("Heap-Selbsttest: %d Uploads à %u Bytes, größter Block %u nach Durchlauf 0, danach %u..%u – %s\n",
+                UPLOADS, (unsigned)payload.size(), (unsigned)first, (unsigned)lowest, (unsigned)highest,
+                stable ? "stabil" : "INSTABIL");
+  assert(stable);
+}
+#endif
+
+static void collectStoredEvent(const CalStreamEvent &evt, void *ctx)
+{
+  if (evt.start[0]) ((std::vector<CalStreamEvent> *)ctx)->push_back(evt);
+}
+
+// Gespeicherte Kalenderdaten vollständig (alle Tage) als Events laden
+static bool loadCalendarStore(std::vector<CalStreamEvent> &events) {
+  bool binary = SPIFFS.exists(CAL_FILE_BIN);
+  File file = SPIFFS.open(binary ? CAL_FILE_BIN : CAL_FILE_JSON, "r");
+  if (!file) return false;
+  bool ok;
+  if (binary) {
+    std::vector<uint8_t> buf(file.size());
+    ok = file.read(buf.data(), buf.size()) == buf.size() &&
+         calBinDecode(buf.data(), buf.size(), collectStoredEvent, &events);
+  } else {
+    CalStream parser;
+    parser.begin(collectStoredEvent, &events);
+    char block[256];
+    while (file.available()) {
+      size_t n = file.read((uint8_t*)block, sizeof(block));
+      if (n == 0) break;
+      parser.feed(block, n);
+    }
+    ok = parser.finish();
+  }
+  file.close();
+  return ok;
+}
+
+struct DeltaMerge {
+  std::vector<CalStreamEvent> *events;
+  size_t upserts, deletes;
+};
+
+static void applyDeltaOp(const CalStreamEvent &evt, uint8_t op, void *ctx)
+{
+  DeltaMerge *m = (DeltaMerge *)ctx;
+  uint32_t id = calBinEventId(evt);
+  auto it = std::find_if(m->events->begin(), m->events->end(),
+                         [id](const CalStreamEvent &e) { return calBinEventId(e) == id; });
+  if (op == CALBIN_OP_DELETE) {
+    if (it != m->events->end()) m->events->erase(it);
+    m->deletes++;
+  } else {
+    if (it != m->events->end()) *it = evt;
+    else m->events->push_back(evt);
+    m->upserts++;
+  }
+}
+
+// Wendet ein CalBin-Delta (LEND:) auf den gespeicherten Stand an und liefert das komplette
+// neue Dokument. Passt `base` nicht zum Gerätestand, wird das Delta verworfen (Host sendet dann voll).
+bool applyCalendarDelta(const uint8_t* delta, size_t len, uint32_t base, std::vector<uint8_t>& merged) {
+  if (!calStoreSetHash || base != calStoreSetHash) {
+    Serial.printf("Delta-Basis 0x%08lX passt nicht zum Stand 0x%08lX – verworfen.\n",
+                  (unsigned long)base, (unsigned long)calStoreSetHash);
+    return false;
+  }
+  std::vector<CalStreamEvent> events;
+  if (!loadCalendarStore(events)) {
+    Serial.println("Gespeicherte Kalenderdaten nicht lesbar – Delta verworfen.");
+    return false;
+  }
+  DeltaMerge m = {&events, 0, 0};
+  if (!calBinDecodeOps(delta, len, applyDeltaOp, &m)) {
+    Serial.println("Delta ungültig – verworfen.");
+    return false;
+  }
+  // Nach Start (UTC-Epoch, unabhängig vom Offset im String), bei gleichem Start nach ID –
+  // dieselbe Reihenfolge wie payload_order() in cal.py, damit der Events-Hash übereinstimmt
+  std::sort(events.begin(), events.end(), [](const CalStreamEvent &a, const CalStreamEvent &b) {
+    uint32_t sa = a.hasStartTime ? a.startTime.epoch : 0, sb = b.hasStartTime ? b.startTime.epoch : 0;
+    return sa != sb ? sa < sb : calBinEventId(a) < calBinEventId(b);
+  });
+  if (!calBinEncode(events.data(), events.size(), merged)) {
+    Serial.println("Delta-Ergebnis zu groß – verworfen.");
+    return false;
+  }
+  Serial.printf("Delta angewendet: %u geändert/neu, %u gelöscht, %u Events gesamt.\n",
+                (unsigned)m.upserts, (unsigned)m.deletes, (unsigned)events.size());
   return true;
 }
 
@@ -688,8 +1426,11 @@ void setup()
 
   // Mount SPIFFS early (needed for wifi.json)
   if (!mountSPIFFS()) return;
+  loadPayloadDigest();
 
-  // BLE früh initialisieren (unabhängig von WiFi)
+  // BLE früh initialisieren (unabhängig von WiFi); Writes landen bis zum Start des Workers im Ring
+  bleRing.begin(bleRingStorage, sizeof(bleRingStorage));
+  bleInflate.reserve(); // Decompressor-Zustand einmalig, solange der Heap noch unzerstückelt ist
   initBLE();
 
   // Zeitzone immer konfigurieren, auch ohne WiFi/NTP.
@@ -712,29 +1453,34 @@ void setup()
   digitalWrite(EPD_PWR, HIGH);
   SPI.begin(EPD_SCK, -1, EPD_MOSI, EPD_CS);
   display.init();
+  // Vergleichswert für CAL_PAGE_HEIGHT: der GxEPD2-Puffer liegt statisch im RAM, das Band nur beim Zeichnen im Heap
+  Serial.printf("Display-Puffer: %u Bytes (%u Zeilen pro Seite), Band %u Bytes, Heap frei %u, Minimum %u Bytes.\n",
+                (unsigned)(CalPanel::WIDTH / 4 * DISPLAY_PAGE_ROWS), (unsigned)DISPLAY_PAGE_ROWS,
+                (unsigned)(CalPanel::WIDTH / 4 * CAL_PAGE_HEIGHT), (unsigned)ESP.getFreeHeap(), (unsigned)ESP.getMinFreeHeap());
 
-  // Start mit vorhandener Datei (falls vorhanden)
-  String jsonStr = loadFile("/calendar-condensed.json");
-  if (!jsonStr.isEmpty()) {
-    updateCalendarFromJson(jsonStr, false);
-  } else {
-    Serial.println("Keine bestehende Kalender-Datei. Warte auf BLE Upload.");
+  // Start mit vorhandenen Daten: bevorzugt Tages-Cache (nur Lookup), sonst Datei parsen
+  if (!updateCalendarFromDayCache(false)) {
+    if (SPIFFS.exists(CAL_FILE_BIN) || SPIFFS.exists(CAL_FILE_JSON)) {
+      updateCalendarFromFile(false);
+    } else {
+      Serial.println("Keine bestehende Kalender-Datei. Warte auf BLE Upload.");
+    }
   }
 
+#if CAL_HEAP_SELFTEST
+  calHeapSelfTest(); // vor dem Worker: Arena und Parser gehören sonst dem Worker-Task
+#endif
+
+  // Worker erst nach dem ersten Redraw starten, damit nur ein Task das Display benutzt
+  xTaskCreate(calWorkerTask, "calWorker", 8192, nullptr, 1, &calWorker);
+  xTaskNotifyGive(calWorker);
+
   // Deep Sleep erst wieder aktivieren, wenn BLE nicht ständig verfügbar sein soll.
   // (Sonst würde Verbindung abbrechen.)
 }
 
 void loop()
 {
-  if (bleTransferActive) {
-    if (millis() - bleLastChunkMillis > BLE_TRANSFER_TIMEOUT_MS) {
-      Serial.println("BLE Transfer Timeout – Reset.");
-      bleTransferActive = false;
-      bleExpectedLen = 0;
-      if (bleBuffer) { free(bleBuffer); bleBuffer = nullptr; }
-      bleBufferWritePos = 0;
-    }
-  }
-  delay(200);
+  // Transfers und Timeout laufen im Worker-Task (calWorkerTask)
+  delay(1000);
 }
\ No newline at end of file
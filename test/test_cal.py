@@ -0,0 +1,73 @@
+"""Host-Tests für cal.py ohne BLE-Gerät und ohne Graph-Zugang.
+
+Aufruf aus dem Repo-Wurzelverzeichnis: python3 -m unittest discover -s test -p "test_*.py"
+"""
+import json, os, sys, unittest, zlib
+
+ROOT = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+sys.path.insert(0, ROOT)
+import cal  # noqa: E402
+
+CALENDAR = os.path.join(ROOT, "data", "calendar-condensed.json")
+CHUNK = 244  # MTU 247 - 3, wie --chunk-size
+
+
+def inflate_chunked(packed: bytes, chunk: int):
+    """Entpackt chunkweise wie die Firmware (tinfl, ein BLE-Write nach dem anderen)."""
+    d = zlib.decompressobj()
+    out = bytearray()
+    for i in range(0, len(packed), chunk):
+        out += d.decompress(packed[i:i + chunk])
+    out += d.flush()
+    return bytes(out), d.eof
+
+
+class LenzRoundTrip(unittest.TestCase):
+    """LENZ:-Upload: Payload komprimieren, chunkweise entpacken, mit dem Original vergleichen."""
+
+    def round_trip(self, fmt: str) -> bytes:
+        raw = cal.build_payload(CALENDAR, fmt)
+        self.assertTrue(raw)
+        packed = cal.compress_payload(raw)
+        self.assertLess(len(packed), len(raw))
+        for chunk in (1, 20, CHUNK):
+            out, eof = inflate_chunked(packed, chunk)
+            self.assertTrue(eof, f"{fmt}: zlib-Stream nicht abgeschlossen (Chunk {chunk})")
+            self.assertEqual(out, raw, f"{fmt}: Round-Trip weicht ab (Chunk {chunk})")
+        return raw
+
+    def test_json(self):
+        raw = self.round_trip("json")
+        with open(CALENDAR, "r", encoding="utf-8") as f:
+            events = json.load(f)
+        slim = json.loads(raw)
+        self.assertEqual(len(slim), len(events))
+        self.assertTrue(all(set(e) <= set(cal.DEVICE_FIELDS) for e in slim))
+
+    def test_bin(self):
+        raw = self.round_trip("bin")
+        self.assertTrue(raw.startswith(cal.CALBIN_MAGIC))
+
+
+class PrepareUpload(unittest.TestCase):
+    """Header-Wahl in prepare_upload ohne bzw. mit Gerätestatus."""
+
+    def test_without_status(self):
+        # Ältere Firmware ohne Status-Characteristic: nur LEN: mit JSON, kein Delta, kein zlib
+        header, data, events = cal.prepare_upload(CALENDAR, "bin", True, True, 60000, None)
+        self.assertEqual(header, f"LEN:{len(data)}\n".encode())
+        self.assertEqual(data, cal.build_payload(CALENDAR, "json"))
+        self.assertTrue(events)
+
+    def test_status_without_caps(self):
+        status = {"date": "", "events": 0, "payload": 0}
+        header, data, _ = cal.prepare_upload(CALENDAR, "bin", True, True, 60000, status)
+        self.assertEqual(header, f"LEN:{len(data)}\n".encode())
+        self.assertEqual(data, cal.build_payload(CALENDAR, "bin"))
+        status["caps"] = "ZD"
+        header, data, _ = cal.prepare_upload(CALENDAR, "bin", True, False, 60000, status)
+        self.assertTrue(header.startswith(b"LENZ:"))
+
+
+if __name__ == "__main__":
+    unittest.main()
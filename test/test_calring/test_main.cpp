@@ -0,0 +1,234 @@
+// test_main.cpp - CalRing on the host (pio test -e native -f test_calring)
+//
+// Edge cases single-threaded (empty, full, oversized records, padding before
+// the wrap), then a producer and a consumer thread pushing numbered records
+// of varying length through a small ring, as the NimBLE callback and
+// calWorkerTask do on the device. Also meant to be run under
+// -fsanitize=thread.
+#include <string.h>
+#include <atomic>
+#include <thread>
+#include <unity.h>
+#include <CalRing.h>
+
+namespace {
+const size_t CAP = 2048; // smallest accepted capacity: 2 * (CALRING_MAX_RECORD + prefix) rounded up
+uint8_t storage[CAP];
+CalRing ring;
+
+// Record `seq`: length 1..CALRING_MAX_RECORD, bytes derived from seq so
+// reordering, truncation and overwrites all show up
+size_t recordLen(uint32_t seq) {
+    return 1 + (seq * 2654435761u >> 7) % CALRING_MAX_RECORD;
+}
+
+void fillRecord(uint32_t seq, uint8_t* out, size_t len) {
+    for (size_t i = 0; i < len; i++) out[i] = (uint8_t)(seq * 31 + i * 7);
+}
+
+bool checkRecord(uint32_t seq, const uint8_t* rec, size_t len) {
+    if (len != recordLen(seq)) return false;
+    for (size_t i = 0; i < len; i++)
+        if (rec[i] != (uint8_t)(seq * 31 + i * 7)) return false;
+    return true;
+}
+}
+
+void setUp() {
+    memset(storage, 0xAA, sizeof(storage));
+    TEST_ASSERT_TRUE(ring.begin(storage, CAP));
+}
+
+void tearDown() {}
+
+void test_begin_rejects_bad_storage() {
+    CalRing r;
+    TEST_ASSERT_FALSE(r.begin(nullptr, CAP));
+    TEST_ASSERT_FALSE(r.begin(storage, CAP - 1));  // not a power of two
+    TEST_ASSERT_FALSE(r.begin(storage, 1024));     // two maximal records do not fit
+    TEST_ASSERT_TRUE(r.begin(storage, CAP));
+}
+
+void test_empty_ring() {
+    size_t len = 99;
+    uint8_t out[CALRING_MAX_RECORD];
+    TEST_ASSERT_TRUE(ring.empty());
+    TEST_ASSERT_NULL(ring.peek(len));
+    TEST_ASSERT_EQUAL_UINT32(0, ring.pop(out));
+    ring.release(); // nothing peeked: no-op
+    TEST_ASSERT_TRUE(ring.empty());
+    TEST_ASSERT_EQUAL_UINT32(0, ring.used());
+}
+
+void test_rejects_empty_and_oversized() {
+    uint8_t big[CALRING_MAX_RECORD + 1] = {0};
+    TEST_ASSERT_FALSE(ring.push(big, 0));
+    TEST_ASSERT_FALSE(ring.push(big, CALRING_MAX_RECORD + 1));
+    TEST_ASSERT_TRUE(ring.empty());
+    TEST_ASSERT_TRUE(ring.push(big, CALRING_MAX_RECORD));
+}
+
+void test_full_ring_writes_nothing() {
+    uint8_t rec[100];
+    uint32_t pushed = 0;
+    for (;; pushed++) {
+        fillRecord(pushed, rec, sizeof(rec));
+        if (!ring.push(rec, sizeof(rec))) break;
+    }
+    TEST_ASSERT_EQUAL_UINT32(CAP / (2 + sizeof(rec)), pushed);
+    size_t used = ring.used();
+    TEST_ASSERT_FALSE(ring.push(rec, 1 + CAP - used)); // larger than the rest: rejected as well
+    TEST_ASSERT_EQUAL_UINT32(used, ring.used());
+    // Room left for a smaller record
+    TEST_ASSERT_TRUE(CAP - used >= 2 + 1);
+    TEST_ASSERT_TRUE(ring.push(rec, CAP - used - 2));
+    TEST_ASSERT_EQUAL_UINT32(CAP, ring.used());
+    TEST_ASSERT_FALSE(ring.push(rec, 1));
+
+    uint8_t out[CALRING_MAX_RECORD];
+    for (uint32_t seq = 0; seq < pushed; seq++) {
+        TEST_ASSERT_EQUAL_UINT32(sizeof(rec), ring.pop(out));
+        uint8_t want[sizeof(rec)];
+        fillRecord(seq, want, sizeof(want));
+        TEST_ASSERT_EQUAL_MEMORY(want, out, sizeof(rec));
+    }
+    TEST_ASSERT_EQUAL_UINT32(CAP - used - 2, ring.pop(out));
+    TEST_ASSERT_TRUE(ring.empty());
+}
+
+// A record that does not fit before the end of the storage is published after
+// padding (WRAP_MARK) and arrives in one piece at offset 0
+void test_wrap_padding() {
+    uint8_t rec[CALRING_MAX_RECORD], out[CALRING_MAX_RECORD];
+    // Move head and tail to CAP - 300
+    fillRecord(0, rec, 498);
+    for (int i = 0; i < 3; i++) TEST_ASSERT_TRUE(ring.push(rec, 498)); // 3 * 500 bytes
+    TEST_ASSERT_TRUE(ring.push(rec, 246));                              // + 248 = CAP - 300
+    for (int i = 0; i < 4; i++) TEST_ASSERT_NOT_EQUAL(0, ring.pop(out));
+    TEST_ASSERT_TRUE(ring.empty());
+
+    fillRecord(7, rec, 400);
+    TEST_ASSERT_TRUE(ring.push(rec, 400)); // 300 bytes padding + 402 bytes record
+    TEST_ASSERT_EQUAL_UINT32(300 + 402, ring.used());
+    TEST_ASSERT_EQUAL_HEX8(0xFF, storage[CAP - 300]);
+    TEST_ASSERT_EQUAL_HEX8(0xFF, storage[CAP - 299]);
+    size_t len = 0;
+    const uint8_t* p = ring.peek(len);
+    TEST_ASSERT_EQUAL_UINT32(400, len);
+    TEST_ASSERT_TRUE(p == storage + 2); // read in place, right after the length prefix
+    TEST_ASSERT_EQUAL_MEMORY(rec, p, 400);
+    ring.release();
+    TEST_ASSERT_TRUE(ring.empty());
+}
+
+// One byte left before the end: too short for a WRAP_MARK, the consumer has
+// to skip it anyway
+void test_wrap_single_byte_gap() {
+    uint8_t rec[CALRING_MAX_RECORD], out[CALRING_MAX_RECORD];
+    fillRecord(0, rec, 509);
+    for (int i = 0; i < 3; i++) TEST_ASSERT_TRUE(ring.push(rec, 509)); // 3 * 511 bytes
+    TEST_ASSERT_TRUE(ring.push(rec, 512));                              // + 514 = CAP - 1
+    for (int i = 0; i < 4; i++) TEST_ASSERT_NOT_EQUAL(0, ring.pop(out));
+
+    fillRecord(3, rec, 10);
+    TEST_ASSERT_TRUE(ring.push(rec, 10));
+    TEST_ASSERT_EQUAL_UINT32(1 + 12, ring.used());
+    TEST_ASSERT_EQUAL_UINT32(10, ring.pop(out));
+    TEST_ASSERT_EQUAL_MEMORY(rec, out, 10);
+    TEST_ASSERT_TRUE(ring.empty());
+}
+
+// Padding plus record must fit together; otherwise push fails without
+// writing the padding
+void test_wrap_needs_room_for_padding() {
+    uint8_t rec[CALRING_MAX_RECORD], out[CALRING_MAX_RECORD];
+    fillRecord(0, rec, 498);
+    for (int i = 0; i < 3; i++) TEST_ASSERT_TRUE(ring.push(rec, 498));
+    TEST_ASSERT_TRUE(ring.push(rec, 246)); // head at CAP - 300
+    TEST_ASSERT_NOT_EQUAL(0, ring.pop(out)); // 800 bytes free: 300 at the end, 500 at the start
+
+    size_t used = ring.used();
+    TEST_ASSERT_FALSE(ring.push(rec, 512)); // 300 padding + 514 > 800
+    TEST_ASSERT_EQUAL_UINT32(used, ring.used());
+    TEST_ASSERT_EQUAL_HEX8(0xAA, storage[CAP - 300]); // no WRAP_MARK written
+
+    TEST_ASSERT_NOT_EQUAL(0, ring.pop(out)); // 1300 bytes free
+    fillRecord(9, rec, 512);
+    TEST_ASSERT_TRUE(ring.push(rec, 512));
+    for (int i = 0; i < 2; i++) TEST_ASSERT_NOT_EQUAL(0, ring.pop(out));
+    TEST_ASSERT_EQUAL_UINT32(512, ring.pop(out));
+    TEST_ASSERT_EQUAL_MEMORY(rec, out, 512);
+    TEST_ASSERT_TRUE(ring.empty());
+}
+
+void test_peek_release() {
+    uint8_t a[3] = {1, 2, 3}, b[5] = {4, 5, 6, 7, 8};
+    TEST_ASSERT_TRUE(ring.push(a, sizeof(a)));
+    TEST_ASSERT_TRUE(ring.push(b, sizeof(b)));
+    size_t len = 0;
+    const uint8_t* p = ring.peek(len);
+    TEST_ASSERT_EQUAL_UINT32(3, len);
+    TEST_ASSERT_EQUAL_MEMORY(a, p, 3);
+    // Peeking again without release returns the same record
+    p = ring.peek(len);
+    TEST_ASSERT_EQUAL_UINT32(3, len);
+    ring.release();
+    ring.release(); // second release drops nothing
+    p = ring.peek(len);
+    TEST_ASSERT_EQUAL_UINT32(5, len);
+    TEST_ASSERT_EQUAL_MEMORY(b, p, 5);
+    ring.release();
+    TEST_ASSERT_TRUE(ring.empty());
+}
+
+// Producer and consumer on separate threads; the producer retries while the
+// ring is full (the device drops the write and the upload times out instead)
+void test_spsc_stress() {
+    const uint32_t RECORDS = 200000;
+    std::atomic<bool> failed{false};
+    std::thread producer([&] {
+        uint8_t rec[CALRING_MAX_RECORD];
+        for (uint32_t seq = 0; seq < RECORDS && !failed.load(std::memory_order_relaxed); seq++) {
+            size_t len = recordLen(seq);
+            fillRecord(seq, rec, len);
+            while (!ring.push(rec, len))
+                if (failed.load(std::memory_order_relaxed)) return;
+                else std::this_thread::yield();
+        }
+    });
+    uint32_t seq = 0, wraps = 0;
+    size_t lastAt = 0;
+    while (seq < RECORDS && !failed) {
+        size_t len = 0;
+        const uint8_t* p = ring.peek(len);
+        if (!p) { std::this_thread::yield(); continue; }
+        size_t at = (size_t)(p - storage);
+        if (at < lastAt) wraps++;
+        lastAt = at;
+        if (at + len > CAP || !checkRecord(seq, p, len)) {
+            failed = true;
+            break;
+        }
+        ring.release();
+        seq++;
+    }
+    producer.join();
+    TEST_ASSERT_FALSE_MESSAGE(failed.load(), "record lost, reordered or corrupted");
+    TEST_ASSERT_EQUAL_UINT32(RECORDS, seq);
+    TEST_ASSERT_TRUE(ring.empty());
+    TEST_ASSERT_TRUE(wraps > 1000);
+}
+
+int main(int, char**) {
+    UNITY_BEGIN();
+    RUN_TEST(test_begin_rejects_bad_storage);
+    RUN_TEST(test_empty_ring);
+    RUN_TEST(test_rejects_empty_and_oversized);
+    RUN_TEST(test_full_ring_writes_nothing);
+    RUN_TEST(test_wrap_padding);
+    RUN_TEST(test_wrap_single_byte_gap);
+    RUN_TEST(test_wrap_needs_room_for_padding);
+    RUN_TEST(test_peek_release);
+    RUN_TEST(test_spsc_stress);
+    return UNITY_END();
+}
@@ -0,0 +1,182 @@
+// test_main.cpp - CalTime on the host (pio test -e native -f test_caltime -v)
+//
+// calTimeParse against known epochs (offsets, month and year ends, leap day),
+// malformed input, the calTimeFromEpoch/calTimeFormatIso round trip and
+// calEventEndMin. test_bench_vs_string times calTimeParse against the former
+// approach (timestamps copied into String, minutes via indexOf/substring/toInt)
+// and prints one line
+//   BENCH {"name":"caltime","ns_string":…,"ns_caltime":…,"speedup":…}
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+#include <unity.h>
+#include <Arduino.h>
+#include <WString.h>
+#include <CalEvents.h>
+#include <CalTime.h>
+
+namespace {
+void assertTime(const char* iso, uint32_t epoch, int16_t offsetMin, uint16_t minutes, int32_t day) {
+    CalTime t;
+    TEST_ASSERT_TRUE_MESSAGE(calTimeParse(iso, t), iso);
+    TEST_ASSERT_EQUAL_UINT32(epoch, t.epoch);
+    TEST_ASSERT_EQUAL_INT(offsetMin, t.offsetMin);
+    TEST_ASSERT_EQUAL_INT(minutes, t.minutes);
+    TEST_ASSERT_EQUAL_INT(day, t.day);
+}
+
+int32_t parseDay(const char* date) {
+    int32_t day = 0;
+    TEST_ASSERT_TRUE_MESSAGE(calTimeParseDay(date, day), date);
+    return day;
+}
+
+// Former way: String copies, date per strncmp, minutes per indexOf/substring/toInt
+int stringMinutes(const String& iso) {
+    int t = iso.indexOf('T');
+    return (int)(iso.substring(t + 1, t + 3).toInt() * 60 + iso.substring(t + 4, t + 6).toInt());
+}
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_offsets() {
+    const int32_t day = parseDay("2025-09-11");
+    TEST_ASSERT_EQUAL_INT(20342, day);
+    assertTime("2025-09-11T09:00:00+0200", 1757574000, 120, 540, day);
+    assertTime("2025-09-11T09:00:00+02:00", 1757574000, 120, 540, day);
+    assertTime("2025-09-11T09:00+0200", 1757574000, 120, 540, day); // no seconds
+    assertTime("2025-09-11T07:00:00Z", 1757574000, 0, 420, day);
+    assertTime("2025-09-11T07:00:00", 1757574000, 0, 420, day);     // no offset = +0000
+    assertTime("2025-09-11T07:00:00.1234567Z", 1757574000, 0, 420, day); // Graph fractions
+    assertTime("2025-09-11T09:00:00-0530", 1757601000, -330, 540, day);
+}
+
+// The local day comes from the written offset, not from UTC
+void test_month_and_year_end() {
+    // UTC is already 2026-01-01 00:30, locally still New Year's Eve
+    assertTime("2025-12-31T23:30:00-0100", 1767227400, -60, 1410, parseDay("2025-12-31"));
+    // UTC is still 2025-12-31 23:30, locally already New Year
+    assertTime("2026-01-01T00:30:00+0100", 1767223800, 60, 30, parseDay("2026-01-01"));
+    TEST_ASSERT_EQUAL_INT(parseDay("2025-12-31") + 1, parseDay("2026-01-01"));
+    TEST_ASSERT_EQUAL_INT(parseDay("2025-09-30") + 1, parseDay("2025-10-01"));
+    assertTime("2024-02-29T12:00:00Z", 1709208000, 0, 720, 19782);
+    TEST_ASSERT_EQUAL_INT(parseDay("2024-02-28") + 2, parseDay("2024-03-01"));
+    TEST_ASSERT_EQUAL_INT(parseDay("2025-02-28") + 1, parseDay("2025-03-01"));
+    assertTime("2025-09-12T23:45:00Z", 1757720700, 0, 1425, 20343);
+    // Fractions, then the end of daylight saving time
+    assertTime("2025-10-26T02:30:00.123+0100", 1761442200, 60, 150, 20387);
+}
+
+void test_malformed() {
+    const char* bad[] = {
+        "",
+        "2025-09-11",              // date only
+        "2025-09-11 09:00:00Z",    // no T
+        "2025-13-01T09:00:00Z",    // month
+        "2025-00-10T09:00:00Z",
+        "2025-09-32T09:00:00Z",    // day
+        "2025-09-11T24:00:00Z",    // hour
+        "2025-09-11T09:60:00Z",    // minute
+        "2025-09-11T9:00:00Z",
+        "2025-09-11T09:00:0",      // truncated seconds
+        "2025-09-11T09:00:00+2",   // truncated offset
+        "2025-09-11T09:00:00+02:",
+        "2025-09-11T09:00:00+ab00",
+        "20x5-09-11T09:00:00Z",
+        "2025/09/11T09:00:00Z",
+    };
+    for (const char* s : bad) {
+        CalTime t;
+        TEST_ASSERT_FALSE_MESSAGE(calTimeParse(s, t), s);
+    }
+    int32_t day;
+    TEST_ASSERT_FALSE(calTimeParseDay("2025-9-11", day));
+    TEST_ASSERT_FALSE(calTimeParseDay("", day));
+}
+
+void test_epoch_round_trip() {
+    const char* iso[] = {"2025-09-11T09:00:00+0200", "2025-12-31T23:30:00-0100", "2024-02-29T00:00:00+0000",
+                         "2025-09-11T09:00:00-0530", "1970-01-01T00:00:00+0000"};
+    for (const char* s : iso) {
+        CalTime a, b;
+        TEST_ASSERT_TRUE(calTimeParse(s, a));
+        calTimeFromEpoch(a.epoch, a.offsetMin, b);
+        TEST_ASSERT_EQUAL_INT(a.minutes, b.minutes);
+        TEST_ASSERT_EQUAL_INT(a.day, b.day);
+        char out[32];
+        calTimeFormatIso(b, out, sizeof(out));
+        TEST_ASSERT_EQUAL_STRING(s, out);
+    }
+    char out[11];
+    calTimeFormatDay(parseDay("2024-02-29"), out, sizeof(out));
+    TEST_ASSERT_EQUAL_STRING("2024-02-29", out);
+}
+
+void test_end_minute() {
+    CalTime start, end;
+    calTimeParse("2025-09-11T09:00:00+0200", start);
+    calTimeParse("2025-09-11T09:15:00+0200", end);
+    TEST_ASSERT_EQUAL_INT(555, calEventEndMin(start, end));
+    // Same instant written with another offset
+    calTimeParse("2025-09-11T07:15:00Z", end);
+    TEST_ASSERT_EQUAL_INT(555, calEventEndMin(start, end));
+    // Over midnight: clamped to the end of the start day
+    calTimeParse("2025-09-11T23:00:00+0200", start);
+    calTimeParse("2025-09-12T01:00:00+0200", end);
+    TEST_ASSERT_EQUAL_INT(24 * 60, calEventEndMin(start, end));
+    // End before start
+    calTimeParse("2025-09-11T08:00:00+0200", end);
+    TEST_ASSERT_EQUAL_INT(start.minutes, calEventEndMin(start, end));
+}
+
+// Per event: resolve start and end, compare the day
+void test_bench_vs_string() {
+    static const char* STARTS[4] = {"2025-09-11T09:00:00+0200", "2025-09-11T13:30:00+0200",
+                                    "2025-10-26T02:30:00+0100", "2025-09-12T23:45:00Z"};
+    static const char* ENDS[4] = {"2025-09-11T09:15:00+0200", "2025-09-11T14:00:00+0200",
+                                  "2025-10-26T03:00:00+0100", "2025-09-13T00:15:00Z"};
+    const int ROUNDS = 200000;
+    const char* today = "2025-09-11";
+    const int32_t todayDay = parseDay(today);
+    typedef std::chrono::steady_clock Clock;
+    volatile uint32_t sink = 0;
+    uint32_t stringSum = 0, calTimeSum = 0;
+
+    Clock::time_point t0 = Clock::now();
+    for (int i = 0; i < ROUNDS; ++i) {
+        String start(STARTS[i & 3]), end(ENDS[i & 3]);
+        bool isToday = strncmp(start.c_str(), today, 10) == 0;
+        stringSum += stringMinutes(start) + isToday;
+        sink += stringMinutes(end);
+    }
+    double nsString = std::chrono::duration<double, std::nano>(Clock::now() - t0).count() / ROUNDS;
+
+    t0 = Clock::now();
+    for (int i = 0; i < ROUNDS; ++i) {
+        CalTime start, end;
+        calTimeParse(STARTS[i & 3], start);
+        calTimeParse(ENDS[i & 3], end);
+        calTimeSum += start.minutes + (start.day == todayDay);
+        sink += calEventEndMin(start, end);
+    }
+    double nsCalTime = std::chrono::duration<double, std::nano>(Clock::now() - t0).count() / ROUNDS;
+    (void)sink;
+
+    printf("BENCH {\"name\":\"caltime\",\"ns_string\":%.1f,\"ns_caltime\":%.1f,\"speedup\":%.1f}\n", nsString,
+           nsCalTime, nsCalTime > 0 ? nsString / nsCalTime : 0.0);
+    // Both ways agree on start minutes and the day match
+    TEST_ASSERT_EQUAL_UINT32(stringSum, calTimeSum);
+}
+
+int main(int, char**) {
+    UNITY_BEGIN();
+    RUN_TEST(test_offsets);
+    RUN_TEST(test_month_and_year_end);
+    RUN_TEST(test_malformed);
+    RUN_TEST(test_epoch_round_trip);
+    RUN_TEST(test_end_minute);
+    RUN_TEST(test_bench_vs_string);
+    return UNITY_END();
+}
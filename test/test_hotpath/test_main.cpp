@@ -0,0 +1,298 @@
+// test_main.cpp - hot-path benchmarks on the host (pio test -e native -f test_hotpath -v)
+//
+// Days with 1, 10, 100 and 1000 events, seeded from data/calendar-condensed.json
+// and spread over one day, go through the same code as an upload on the
+// device: JSON streamed into CalStream or a CalBin document decoded, collected
+// into a CalEventDay, stored in and loaded from the day cache (CalDays),
+// hashed, laid out (CalLayout) and wrapped (CalText, glyph advances of the
+// title font). Every measurement prints one line
+//   BENCH {"name":…,"events":…,"reps":…,"us_per_op":…,"allocs_per_op":…,"bytes_per_op":…}
+// (allocations = operator new in this process), e.g. for
+// `pio test -e native -f test_hotpath -v | grep '^BENCH ' | cut -c7-`.
+// The asserts guard what the numbers rely on: JSON and CalBin ingest give the
+// same day hash, the day cache round-trips and the layout is valid.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <new>
+#include <string>
+#include <vector>
+#include <unity.h>
+#include <Arduino.h>
+#include <gfxfont.h>
+#include <Fonts/FreeSansBold7pt7b.h>
+#include <CalBin.h>
+#include <CalDays.h>
+#include <CalEvents.h>
+#include <CalLayout.h>
+#include <CalStream.h>
+#include <CalText.h>
+#include <CalTime.h>
+
+namespace {
+bool counting = false;
+uint32_t allocs = 0, allocBytes = 0;
+}
+
+// Out of line, so GCC does not pair the inlined malloc/free with new/delete
+__attribute__((noinline)) void* operator new(size_t n) {
+    if (counting) { allocs++; allocBytes += (uint32_t)n; }
+    void* p = malloc(n ? n : 1);
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+__attribute__((noinline)) void operator delete(void* p) noexcept { free(p); }
+__attribute__((noinline)) void operator delete(void* p, size_t) noexcept { free(p); }
+
+namespace {
+typedef std::chrono::steady_clock Clock;
+
+const char* DAY = "2025-09-11";
+const int16_t OFFSET_MIN = 120; // CEST
+
+// Seeds: the events of data/calendar-condensed.json (pio test runs from the
+// project root), so texts, lengths and flags are those of a real calendar;
+// long titles wrap, organizers and locations repeat and are interned once
+const char* SEED_FILE = "data/calendar-condensed.json";
+
+void collectSeed(const CalStreamEvent& evt, void* ctx) {
+    if (evt.hasStartTime) ((std::vector<CalStreamEvent>*)ctx)->push_back(evt);
+}
+
+const std::vector<CalStreamEvent>& seeds() {
+    static std::vector<CalStreamEvent> loaded;
+    if (!loaded.empty()) return loaded;
+    FILE* f = fopen(SEED_FILE, "rb");
+    if (!f) return loaded;
+    CalStream parser;
+    parser.begin(collectSeed, &loaded);
+    char block[256];
+    for (size_t n; (n = fread(block, 1, sizeof(block), f)) > 0;) parser.feed(block, n);
+    fclose(f);
+    if (!parser.finish()) loaded.clear();
+    return loaded;
+}
+
+// Synthetic event `i`: texts and flags of seed i % n, its duration, start
+// spread over 07:00-18:00 on DAY
+void makeEvent(size_t i, CalStreamEvent& evt) {
+    const std::vector<CalStreamEvent>& all = seeds();
+    const CalStreamEvent& s = all[i % all.size()];
+    evt = s;
+    uint32_t duration = s.hasEndTime && s.endTime.epoch > s.startTime.epoch ? s.endTime.epoch - s.startTime.epoch : 30 * 60;
+    int32_t day = 0;
+    calTimeParseDay(DAY, day);
+    int32_t minute = 7 * 60 + (int32_t)((i * 35) % 660) / 5 * 5;
+    calTimeFromEpoch((uint32_t)(day * 86400 - OFFSET_MIN * 60 + minute * 60), OFFSET_MIN, evt.startTime);
+    calTimeFromEpoch(evt.startTime.epoch + duration, OFFSET_MIN, evt.endTime);
+    evt.hasStartTime = evt.hasEndTime = true;
+    calTimeFormatIso(evt.startTime, evt.start, sizeof(evt.start));
+    calTimeFormatIso(evt.endTime, evt.end, sizeof(evt.end));
+    evt.id = 0x10000 + (uint32_t)i;
+    evt.hasId = true;
+}
+
+void jsonString(std::string& out, const char* key, const char* val) {
+    out += '"'; out += key; out += "\":\"";
+    for (; *val; ++val) {
+        unsigned char c = (unsigned char)*val;
+        if (c == '"' || c == '\\') { out += '\\'; out += (char)c; }
+        else if (c < 0x20) { char u[8]; snprintf(u, sizeof(u), "\\u%04x", c); out += u; }
+        else out += (char)c;
+    }
+    out += "\",";
+}
+
+// The condensed schema as uploaded by cal.py --format json
+std::string makeJson(size_t count) {
+    std::string out = "[";
+    CalStreamEvent e;
+    for (size_t i = 0; i < count; i++) {
+        makeEvent(i, e);
+        if (i) out += ',';
+        out += '{';
+        jsonString(out, "start", e.start);
+        jsonString(out, "end", e.end);
+        if (e.hasTitle) jsonString(out, "subject", e.title);
+        jsonString(out, "organizer", e.organizer);
+        jsonString(out, "location", e.location);
+        char tail[200];
+        snprintf(tail, sizeof(tail),
+                 "\"importance\":\"%s\",\"isOnlineMeeting\":%s,\"isRecurring\":%s,\"isMoved\":%s,"
+                 "\"hasAttachments\":%s,\"isCancelled\":%s,\"id\":\"%08lx\"}",
+                 e.isImportant ? "high" : "normal", e.isOnlineMeeting ? "true" : "false",
+                 e.isRecurring ? "true" : "false", e.isMoved ? "true" : "false",
+                 e.hasAttachments ? "true" : "false", e.isCanceled ? "true" : "false", (unsigned long)e.id);
+        out += tail;
+    }
+    return out + "]";
+}
+
+// Same as collectEvent() in main.cpp, for a single day
+struct DayFilter {
+    int32_t day;
+    CalEventDay events;
+};
+
+void collectEvent(const CalStreamEvent& evt, void* ctx) {
+    DayFilter* f = (DayFilter*)ctx;
+    if (!evt.start[0] || !evt.hasStartTime || evt.startTime.day != f->day)
+        return;
+    char location[CALSTREAM_LOCATION_LEN];
+    calEventDisplayLocation(evt.location, location, sizeof(location));
+    uint16_t endMin = evt.hasEndTime ? calEventEndMin(evt.startTime, evt.endTime) : 0;
+    f->events.add(evt.startTime.minutes, endMin, calBinFlags(evt),
+                  evt.hasTitle ? evt.title : CALEVENT_NO_TITLE, evt.organizer, location);
+}
+
+void resetFilter(DayFilter& f) {
+    calTimeParseDay(DAY, f.day);
+    f.events.clear();
+}
+
+struct Bench {
+    Clock::time_point t0;
+    double us = 0;
+    void begin() {
+        allocs = allocBytes = 0;
+        counting = true;
+        t0 = Clock::now();
+    }
+    void pause() {
+        us += std::chrono::duration<double, std::micro>(Clock::now() - t0).count();
+        counting = false;
+    }
+    void resume() {
+        counting = true;
+        t0 = Clock::now();
+    }
+    void report(const char* name, int events, int reps) {
+        if (counting) pause();
+        printf("BENCH {\"name\":\"%s\",\"events\":%d,\"reps\":%d,\"us_per_op\":%.2f,\"allocs_per_op\":%.1f,"
+               "\"bytes_per_op\":%lu}\n",
+               name, events, reps, us / reps, (double)allocs / reps, (unsigned long)(allocBytes / reps));
+        us = 0;
+    }
+};
+
+// One box per event, columns and spans inside the group, no two boxes of a
+// column overlap in time
+bool layoutValid(const CalEventDay& day, const std::vector<CalLayoutBox>& boxes) {
+    if (boxes.size() != day.size()) return false;
+    for (size_t i = 0; i < boxes.size(); i++) {
+        const CalLayoutBox& a = boxes[i];
+        if (a.column < 0 || a.colSpan < 1 || a.column + a.colSpan > a.groupColumns) return false;
+        int aEnd = a.endMin > a.startMin ? a.endMin : a.startMin + 60;
+        for (size_t j = i + 1; j < boxes.size() && boxes[j].startMin < aEnd; j++) {
+            const CalLayoutBox& b = boxes[j];
+            if (b.column < a.column + a.colSpan && a.column < b.column + b.colSpan) return false;
+        }
+    }
+    return true;
+}
+
+void runHotPath(int n) {
+    int reps = n >= 1000 ? 20 : n >= 100 ? 200 : 2000;
+    Bench bench;
+    char msg[64];
+    snprintf(msg, sizeof(msg), "%d events", n);
+    TEST_ASSERT_FALSE_MESSAGE(seeds().empty(), "data/calendar-condensed.json missing or unreadable");
+
+    // JSON: fed in 244-byte writes like a BLE upload
+    std::string json = makeJson(n);
+    static CalStream parser;
+    DayFilter fromJson;
+    bench.begin();
+    for (int r = 0; r < reps; r++) {
+        bench.pause();
+        resetFilter(fromJson);
+        bench.resume();
+        parser.begin(collectEvent, &fromJson);
+        for (size_t off = 0; off < json.size(); off += 244)
+            parser.feed(json.data() + off, json.size() - off < 244 ? json.size() - off : 244);
+    }
+    bench.report("parse_json", n, reps);
+    TEST_ASSERT_TRUE_MESSAGE(parser.finish(), msg);
+    TEST_ASSERT_EQUAL_UINT32(n, fromJson.events.size());
+
+    // CalBin: decode + collect
+    std::vector<CalStreamEvent> events(n);
+    for (int i = 0; i < n; i++) makeEvent(i, events[i]);
+    std::vector<uint8_t> bin;
+    TEST_ASSERT_TRUE(calBinEncode(events.data(), events.size(), bin));
+    DayFilter fromBin;
+    bench.begin();
+    for (int r = 0; r < reps; r++) {
+        bench.pause();
+        resetFilter(fromBin);
+        bench.resume();
+        calBinDecode(bin.data(), bin.size(), collectEvent, &fromBin);
+    }
+    bench.report("parse_bin", n, reps);
+    TEST_ASSERT_EQUAL_UINT32(n, fromBin.events.size());
+    TEST_ASSERT_EQUAL_UINT32(fromJson.events.hash(), fromBin.events.hash());
+    const CalEventDay& day = fromBin.events;
+
+    volatile uint32_t sink = 0;
+    const int inner = reps * 10;
+    bench.begin();
+    for (int r = 0; r < inner; r++) sink += day.hash();
+    bench.report("hash", n, inner);
+
+    std::vector<CalLayoutBox> boxes;
+    bench.begin();
+    for (int r = 0; r < reps; r++) boxes = computeCalendarLayout(day);
+    bench.report("layout", n, reps);
+    TEST_ASSERT_TRUE_MESSAGE(layoutValid(day, boxes), msg);
+
+    // Day cache: boot and midnight look up the index and load one record
+    CalDaysWriter writer;
+    writer.begin(0x12345678);
+    TEST_ASSERT_TRUE(writer.addDay(DAY, day, boxes));
+    std::vector<uint8_t> cache;
+    writer.finish(cache);
+    CalDaysHeader hdr;
+    TEST_ASSERT_TRUE(calDaysReadHeader(cache.data(), cache.size(), hdr));
+    CalDaysIndexEntry entry = {};
+    CalEventDay loaded;
+    std::vector<CalLayoutBox> loadedBoxes;
+    bool ok = true;
+    bench.begin();
+    for (int r = 0; r < reps; r++) {
+        ok = ok && calDaysFind(cache.data() + CALDAYS_HEADER_SIZE, calDaysIndexSize(hdr), hdr, DAY, entry) &&
+             calDaysDecodeDay(cache.data() + entry.offset, entry.length, loaded, loadedBoxes);
+    }
+    bench.report("day_cache", n, reps);
+    TEST_ASSERT_TRUE(ok);
+    TEST_ASSERT_EQUAL_UINT32(day.hash(), entry.eventsHash);
+    TEST_ASSERT_EQUAL_UINT32(day.hash(), loaded.hash());
+    TEST_ASSERT_EQUAL_UINT32(boxes.size(), loadedBoxes.size());
+
+    // Titles as in half a column (two parallel events), at most two lines
+    CalTextLine lines[2];
+    bench.begin();
+    for (int r = 0; r < reps; r++)
+        for (size_t i = 0; i < day.size(); i++)
+            sink += calTextWrap(&FreeSansBold7pt7b, day.str(day[i].titleOff), 114, lines, 2);
+    bench.report("wrap", n, reps);
+    (void)sink;
+}
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_hotpath_1(void) { runHotPath(1); }
+void test_hotpath_10(void) { runHotPath(10); }
+void test_hotpath_100(void) { runHotPath(100); }
+void test_hotpath_1000(void) { runHotPath(1000); }
+
+int main(int, char**) {
+    UNITY_BEGIN();
+    RUN_TEST(test_hotpath_1);
+    RUN_TEST(test_hotpath_10);
+    RUN_TEST(test_hotpath_100);
+    RUN_TEST(test_hotpath_1000);
+    return UNITY_END();
+}
@@ -0,0 +1,92 @@
+// PngWriter.cpp
+#include "PngWriter.h"
+#include <stdio.h>
+#include <vector>
+
+namespace {
+// Panel colors in CalBand value order (black, white, yellow, red)
+const uint8_t PALETTE[4][3] = {{0, 0, 0}, {255, 255, 255}, {255, 255, 0}, {255, 0, 0}};
+
+uint32_t crc32(uint32_t crc, const uint8_t* p, size_t len) {
+    crc = ~crc;
+    while (len--) {
+        crc ^= *p++;
+        for (int k = 0; k < 8; k++)
+            crc = (crc >> 1) ^ (0xEDB88320u & (0u - (crc & 1)));
+    }
+    return ~crc;
+}
+
+void put32(std::vector<uint8_t>& o, uint32_t v) {
+    o.push_back((uint8_t)(v >> 24));
+    o.push_back((uint8_t)(v >> 16));
+    o.push_back((uint8_t)(v >> 8));
+    o.push_back((uint8_t)v);
+}
+
+void chunk(std::vector<uint8_t>& png, const char* type, const std::vector<uint8_t>& data) {
+    put32(png, (uint32_t)data.size());
+    size_t at = png.size();
+    png.insert(png.end(), type, type + 4);
+    png.insert(png.end(), data.begin(), data.end());
+    put32(png, crc32(0, &png[at], png.size() - at));
+}
+
+// zlib stream of stored (uncompressed) deflate blocks: no zlib needed and the
+// frame is small enough that size does not matter
+std::vector<uint8_t> zlibStored(const std::vector<uint8_t>& raw) {
+    std::vector<uint8_t> z = {0x78, 0x01};
+    size_t pos = 0;
+    do {
+        size_t n = raw.size() - pos < 65535 ? raw.size() - pos : 65535;
+        z.push_back(pos + n == raw.size() ? 1 : 0);
+        z.push_back((uint8_t)n);
+        z.push_back((uint8_t)(n >> 8));
+        z.push_back((uint8_t)~n);
+        z.push_back((uint8_t)(~n >> 8));
+        z.insert(z.end(), raw.begin() + pos, raw.begin() + pos + n);
+        pos += n;
+    } while (pos < raw.size());
+    uint32_t a = 1, b = 0;
+    for (uint8_t c : raw) {
+        a = (a + c) % 65521;
+        b = (b + a) % 65521;
+    }
+    put32(z, (b << 16) | a);
+    return z;
+}
+}
+
+bool writePng(const CalBand& band, const char* path) {
+    int16_t w = band.width(), h = band.height();
+    size_t rowBytes = ((size_t)w + 3) / 4;
+    std::vector<uint8_t> raw;
+    raw.reserve((rowBytes + 1) * h);
+    for (int16_t y = 0; y < h; y++) {
+        raw.push_back(0); // filter: none
+        for (size_t i = 0; i < rowBytes; i++) {
+            uint8_t b = 0;
+            for (int k = 0; k < 4; k++) {
+                int16_t x = (int16_t)(i * 4 + k);
+                b = (uint8_t)(b << 2 | (x < w ? band.pixel(x, y) : 0));
+            }
+            raw.push_back(b);
+        }
+    }
+
+    static const uint8_t SIGNATURE[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+    std::vector<uint8_t> png(SIGNATURE, SIGNATURE + 8), ihdr, plte;
+    put32(ihdr, (uint32_t)w);
+    put32(ihdr, (uint32_t)h);
+    ihdr.insert(ihdr.end(), {2, 3, 0, 0, 0}); // 2 bit, palette, deflate, no filter, no interlace
+    for (auto& c : PALETTE) plte.insert(plte.end(), c, c + 3);
+    chunk(png, "IHDR", ihdr);
+    chunk(png, "PLTE", plte);
+    chunk(png, "IDAT", zlibStored(raw));
+    chunk(png, "IEND", {});
+
+    FILE* f = fopen(path, "wb");
+    if (!f) return false;
+    bool ok = fwrite(png.data(), 1, png.size(), f) == png.size();
+    return fclose(f) == 0 && ok;
+}
@@ -0,0 +1,8 @@
+// PngWriter.h - a CalBand as 2-bit palette PNG
+#pragma once
+#include <CalBand.h>
+
+// Writes the band as seen on screen (current rotation, rows outside the band
+// white) with the panel's four colors. Returns false if the file cannot be
+// written.
+bool writePng(const CalBand& band, const char* path);
@@ -0,0 +1,24 @@
+#!/bin/sh
+# Builds the host renderer (tools/render/calrender) from the firmware's own
+# drawing code. Adafruit GFX is taken from the PlatformIO dependencies (run
+# `pio pkg install` once) or from GFX_DIR.
+set -e
+cd "$(dirname "$0")"
+ROOT=../..
+GFX_DIR=${GFX_DIR:-"$ROOT/.pio/libdeps/seeed_xiao_esp32c3/Adafruit GFX Library"}
+CXX=${CXX:-g++}
+if [ ! -f "$GFX_DIR/Adafruit_GFX.cpp" ]; then
+    echo "Adafruit GFX not found in $GFX_DIR (set GFX_DIR)" >&2
+    exit 1
+fi
+
+LIBS="CalBand CalBin CalDisplayList CalEvents CalLayout CalRender CalStream CalText CalTime"
+INCLUDES="-Icompat -I$ROOT/include"
+SOURCES="render.cpp PngWriter.cpp $ROOT/lib/CalRender/CalBackground.cpp"
+for lib in $LIBS; do
+    INCLUDES="$INCLUDES -I$ROOT/lib/$lib"
+    SOURCES="$SOURCES $ROOT/lib/$lib/$lib.cpp"
+done
+
+$CXX -std=gnu++17 -O2 -Wall -DARDUINO=10800 $INCLUDES -I"$GFX_DIR" $CXXFLAGS \
+    -o calrender $SOURCES "$GFX_DIR/Adafruit_GFX.cpp"
@@ -0,0 +1,2 @@
+// Adafruit_I2CDevice.h - empty host stand-in (Adafruit BusIO, pulled in by Adafruit_GFX.h)
+#pragma once
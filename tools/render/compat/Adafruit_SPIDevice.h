@@ -0,0 +1,2 @@
+// Adafruit_SPIDevice.h - empty host stand-in (Adafruit BusIO, pulled in by Adafruit_GFX.h)
+#pragma once
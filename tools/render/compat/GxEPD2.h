@@ -0,0 +1,13 @@
+// GxEPD2.h - host stand-in: the GxEPD2 color constants (RGB565) used by CalRender
+#pragma once
+#include <Arduino.h>
+
+#define GxEPD_BLACK     0x0000
+#define GxEPD_DARKGREY  0x7BEF
+#define GxEPD_LIGHTGREY 0xC618
+#define GxEPD_WHITE     0xFFFF
+#define GxEPD_RED       0xF800
+#define GxEPD_YELLOW    0xFFE0
+#define GxEPD_GREEN     0x07E0
+#define GxEPD_BLUE      0x001F
+#define GxEPD_ORANGE    0xFC00
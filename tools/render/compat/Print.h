@@ -0,0 +1,37 @@
+// Print.h - host stand-in for the Arduino Print base of Adafruit_GFX
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "WString.h"
+
+class Print {
+public:
+    virtual ~Print() {}
+    virtual size_t write(uint8_t c) = 0;
+    virtual size_t write(const uint8_t* buf, size_t len) {
+        size_t n = 0;
+        while (len--) n += write(*buf++);
+        return n;
+    }
+    size_t write(const char* s) { return s ? write((const uint8_t*)s, strlen(s)) : 0; }
+    size_t write(const char* buf, size_t len) { return write((const uint8_t*)buf, len); }
+
+    size_t print(const char* s) { return write(s); }
+    size_t print(const String& s) { return write(s.c_str()); }
+    size_t print(const __FlashStringHelper* s) { return write((const char*)s); }
+    size_t print(char c) { return write((uint8_t)c); }
+    size_t print(int v) { return printNumber("%d", v); }
+    size_t print(unsigned v) { return printNumber("%u", v); }
+    size_t print(long v) { return printNumber("%ld", v); }
+    size_t print(unsigned long v) { return printNumber("%lu", v); }
+
+private:
+    template <typename T>
+    size_t printNumber(const char* fmt, T v) {
+        char buf[24];
+        snprintf(buf, sizeof(buf), fmt, v);
+        return write(buf);
+    }
+};
@@ -0,0 +1,30 @@
+// WString.h - host stand-in for the Arduino String (what Adafruit GFX touches,
+// plus the parsing calls used as a baseline in test/test_caltime)
+#pragma once
+#include <stdlib.h>
+#include <string>
+
+class __FlashStringHelper;
+#define F(s) (reinterpret_cast<const __FlashStringHelper*>(s))
+
+class String {
+public:
+    String(const char* s = "") : _s(s ? s : "") {}
+    const char* c_str() const { return _s.c_str(); }
+    unsigned length() const { return (unsigned)_s.size(); }
+    int indexOf(char c) const {
+        size_t i = _s.find(c);
+        return i == std::string::npos ? -1 : (int)i;
+    }
+    // Like Arduino: bounds are swapped if reversed and clamped to the length
+    String substring(unsigned from, unsigned to) const {
+        if (from > to) { unsigned t = from; from = to; to = t; }
+        if (to > _s.size()) to = (unsigned)_s.size();
+        if (from > to) from = to;
+        return String(_s.substr(from, to - from).c_str());
+    }
+    long toInt() const { return atol(_s.c_str()); }
+
+private:
+    std::string _s;
+};
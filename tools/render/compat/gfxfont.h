@@ -0,0 +1,25 @@
+// gfxfont.h - host stand-in: the Adafruit GFX font structs, for code that only
+// measures text (CalText) without linking Adafruit GFX. Same guard as the
+// original, so either one may come first.
+#ifndef _GFXFONT_H_
+#define _GFXFONT_H_
+#include <stdint.h>
+
+typedef struct {
+    uint16_t bitmapOffset;
+    uint8_t width;
+    uint8_t height;
+    uint8_t xAdvance;
+    int8_t xOffset;
+    int8_t yOffset;
+} GFXglyph;
+
+typedef struct {
+    uint8_t* bitmap;
+    GFXglyph* glyph;
+    uint16_t first;
+    uint16_t last;
+    uint8_t yAdvance;
+} GFXfont;
+
+#endif
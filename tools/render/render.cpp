@@ -0,0 +1,283 @@
+// render.cpp - renders a calendar file offscreen into a PNG, exactly as the panel shows it
+//
+//   calrender <calendar-condensed.json | calendar.bin> <out.png>
+//             [--date YYYY-MM-DD] [--time HH:MM] [--battery 0..11] [--native <out.bin>]
+//   calrender --background <CalBackground.cpp>
+//
+// Parsing, layout and drawing are the firmware's own code (CalStream/CalBin,
+// CalLayout, CalRender) on a full-frame CalBand instead of the display
+// buffer. Prints one line per stage, `RENDER {"stage":…,"us":…,"pixels":…}`,
+// and a final `RENDER {"stage":"total",…,"digest":…}` with an FNV-1a over the
+// native frame for golden-image checks.
+//
+// The frame is rendered a second time the way the paged firmware does it:
+// dynamic layer into a CalDisplayList, replayed band by band on top of
+// CAL_BACKGROUND. Both must be identical ("bands_match"); if not, the
+// generated background is stale and --background writes a new one.
+//
+// --native writes the frame as the panel takes it (272 rows of 198 bytes,
+// 2 bits per pixel); cal.py --frame uploads that file with LENP:.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <chrono>
+#include <vector>
+#include <CalBand.h>
+#include <CalBin.h>
+#include <CalDisplayList.h>
+#include <CalEvents.h>
+#include <CalLayout.h>
+#include <CalRender.h>
+#include <CalStream.h>
+#include <CalTime.h>
+#include "PngWriter.h"
+
+namespace {
+typedef std::chrono::steady_clock Clock;
+
+const int16_t PANEL_WIDTH = 792;  // GDEY0579F51, native landscape
+const int16_t PANEL_HEIGHT = 272;
+const uint16_t BAND_ROWS = 32;    // CAL_PAGE_HEIGHT in main.cpp
+
+struct DayFilter {
+    int32_t day;
+    CalEventDay events;
+    size_t skipped = 0;
+};
+
+// Same as collectEvent() in main.cpp, for a single day
+void collectEvent(const CalStreamEvent& evt, void* ctx) {
+    DayFilter* f = (DayFilter*)ctx;
+    if (!evt.start[0] || !evt.hasStartTime || evt.startTime.day != f->day)
+        return;
+    char location[CALSTREAM_LOCATION_LEN];
+    calEventDisplayLocation(evt.location, location, sizeof(location));
+    uint16_t endMin = evt.hasEndTime ? calEventEndMin(evt.startTime, evt.endTime) : 0;
+    if (!f->events.add(evt.startTime.minutes, endMin, calBinFlags(evt),
+                       evt.hasTitle ? evt.title : CALEVENT_NO_TITLE, evt.organizer, location))
+        f->skipped++;
+}
+
+struct Stages {
+    const CalBand* canvas;
+    Clock::time_point mark;
+    uint32_t pixels = 0;
+    double totalUs = 0;
+    uint64_t totalPixels = 0;
+};
+
+void report(const char* stage, void* ctx) {
+    Stages* s = (Stages*)ctx;
+    Clock::time_point now = Clock::now();
+    double us = std::chrono::duration<double, std::micro>(now - s->mark).count();
+    uint32_t pixels = s->canvas->pixelWrites() - s->pixels;
+    printf("RENDER {\"stage\":\"%s\",\"us\":%.1f,\"pixels\":%u}\n", stage, us, (unsigned)pixels);
+    s->totalUs += us;
+    s->totalPixels += pixels;
+    s->pixels = s->canvas->pixelWrites();
+    s->mark = Clock::now(); // printing is not part of the next stage
+}
+
+bool readFile(const char* path, std::vector<uint8_t>& out) {
+    FILE* f = fopen(path, "rb");
+    if (!f) return false;
+    uint8_t buf[4096];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0)
+        out.insert(out.end(), buf, buf + n);
+    bool ok = !ferror(f);
+    fclose(f);
+    return ok;
+}
+
+uint32_t fnv1a(const std::vector<uint8_t>& data) {
+    uint32_t h = 2166136261u;
+    for (uint8_t b : data) {
+        h ^= b;
+        h *= 16777619u;
+    }
+    return h;
+}
+
+// calRenderBackground() as CalRowImage source for the firmware
+int writeBackground(const char* path) {
+    const size_t rowBytes = PANEL_WIDTH / 4;
+    std::vector<uint8_t> buf(rowBytes * PANEL_HEIGHT);
+    CalBand frame(PANEL_WIDTH, PANEL_HEIGHT, buf.data(), PANEL_HEIGHT);
+    frame.setRotation(1);
+    frame.begin(0);
+    calRenderBackground(frame);
+
+    std::vector<uint16_t> index;
+    std::vector<const uint8_t*> rows;
+    for (int16_t y = 0; y < PANEL_HEIGHT; y++) {
+        const uint8_t* row = &buf[y * rowBytes];
+        size_t i = 0;
+        while (i < rows.size() && memcmp(rows[i], row, rowBytes) != 0) i++;
+        if (i == rows.size()) rows.push_back(row);
+        index.push_back((uint16_t)i);
+    }
+
+    FILE* f = fopen(path, "w");
+    if (!f) {
+        fprintf(stderr, "cannot write %s\n", path);
+        return 1;
+    }
+    fprintf(f, "// CalBackground.cpp - generated by tools/render (calrender --background), do not edit\n");
+    fprintf(f, "// calRenderBackground() at rotation 1: %u distinct rows of %u bytes for %u panel rows\n",
+            (unsigned)rows.size(), (unsigned)rowBytes, (unsigned)PANEL_HEIGHT);
+    fprintf(f, "#include \"CalRender.h\"\n\nnamespace {\nconst uint8_t ROWS[] PROGMEM = {\n");
+    for (size_t r = 0; r < rows.size(); r++)
+        for (size_t i = 0; i < rowBytes; i++)
+            fprintf(f, "%s0x%02x,%s", i % 16 ? " " : "    ", rows[r][i], i % 16 == 15 || i + 1 == rowBytes ? "\n" : "");
+    fprintf(f, "};\n\nconst uint16_t INDEX[] PROGMEM = {\n");
+    for (size_t y = 0; y < index.size(); y++)
+        fprintf(f, "%s%u,%s", y % 16 ? " " : "    ", index[y], y % 16 == 15 || y + 1 == index.size() ? "\n" : "");
+    fprintf(f, "};\n}\n\nconst CalRowImage CAL_BACKGROUND = {%u, %u, ROWS, INDEX};\n",
+            (unsigned)PANEL_WIDTH, (unsigned)PANEL_HEIGHT);
+    bool ok = !ferror(f);
+    if (fclose(f) != 0 || !ok) {
+        fprintf(stderr, "cannot write %s\n", path);
+        return 1;
+    }
+    printf("%s: %u distinct rows, %u bytes of flash\n", path, (unsigned)rows.size(),
+           (unsigned)(rows.size() * rowBytes + index.size() * sizeof(uint16_t)));
+    return 0;
+}
+
+bool writeFile(const char* path, const std::vector<uint8_t>& data) {
+    FILE* f = fopen(path, "wb");
+    if (!f) return false;
+    bool ok = fwrite(data.data(), 1, data.size(), f) == data.size();
+    return fclose(f) == 0 && ok;
+}
+
+int usage() {
+    fprintf(stderr, "usage: calrender <calendar.json|calendar.bin> <out.png> [--date YYYY-MM-DD] [--time HH:MM] [--battery 0..11]\n"
+                    "                 [--native <out.bin>]\n"
+                    "       calrender --background <CalBackground.cpp>\n");
+    return 2;
+}
+}
+
+int main(int argc, char** argv) {
+    const char* input = nullptr;
+    const char* output = nullptr;
+    const char* native = nullptr;
+    char date[11] = "";
+    const char* stamp = "";
+    int battery = 11;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--date") && i + 1 < argc) snprintf(date, sizeof(date), "%s", argv[++i]);
+        else if (!strcmp(argv[i], "--time") && i + 1 < argc) stamp = argv[++i];
+        else if (!strcmp(argv[i], "--battery") && i + 1 < argc) battery = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--native") && i + 1 < argc) native = argv[++i];
+        else if (!strcmp(argv[i], "--background") && i + 1 < argc && argc == 3) return writeBackground(argv[++i]);
+        else if (argv[i][0] == '-') return usage();
+        else if (!input) input = argv[i];
+        else if (!output) output = argv[i];
+        else return usage();
+    }
+    if (!input || !output) return usage();
+    if (battery < 0 || battery > 11) battery = 11;
+    if (!date[0]) {
+        // Like the device: today in local time
+        time_t now = time(nullptr);
+        strftime(date, sizeof(date), "%Y-%m-%d", localtime(&now));
+    }
+
+    DayFilter filter;
+    if (!calTimeParseDay(date, filter.day)) {
+        fprintf(stderr, "invalid date: %s\n", date);
+        return 2;
+    }
+    std::vector<uint8_t> payload;
+    if (!readFile(input, payload)) {
+        fprintf(stderr, "cannot read %s\n", input);
+        return 1;
+    }
+
+    std::vector<uint8_t> frameBuffer(PANEL_WIDTH / 4 * PANEL_HEIGHT);
+    CalBand canvas(PANEL_WIDTH, PANEL_HEIGHT, frameBuffer.data(), PANEL_HEIGHT);
+    canvas.setRotation(1);
+    canvas.begin(0);
+    Stages stages;
+    stages.canvas = &canvas;
+    stages.pixels = canvas.pixelWrites();
+    stages.mark = Clock::now();
+
+    bool ok;
+    if (calBinIsBinary(payload.data(), payload.size())) {
+        ok = calBinDecode(payload.data(), payload.size(), collectEvent, &filter);
+    } else {
+        CalStream parser;
+        parser.begin(collectEvent, &filter);
+        parser.feed((const char*)payload.data(), payload.size());
+        ok = parser.finish();
+    }
+    if (!ok) {
+        fprintf(stderr, "cannot parse %s\n", input);
+        return 1;
+    }
+    if (filter.skipped)
+        fprintf(stderr, "%u events skipped (string pool full)\n", (unsigned)filter.skipped);
+    report("parse", &stages);
+
+    std::vector<CalLayoutBox> boxes = computeCalendarLayout(filter.events);
+    report("layout", &stages);
+
+    // Header as on the device: weekday and date of the rendered day
+    time_t dayStart = (time_t)filter.day * 86400;
+    struct tm t;
+    gmtime_r(&dayStart, &t);
+    char weekday[12], dateLine[20];
+    calRenderDateHeader(t, weekday, sizeof(weekday), dateLine, sizeof(dateLine));
+    CalRenderInfo info = {weekday, dateLine, battery, stamp, report, &stages, false};
+    calRenderFrame(canvas, info, filter.events, boxes);
+
+    // Paged firmware: dynamic layer recorded once, each band starts as a copy of CAL_BACKGROUND
+    CalDisplayList list(canvas.width(), canvas.height());
+    info.stage = nullptr;
+    info.background = true;
+    calRenderFrame(list, info, filter.events, boxes);
+    report("list", &stages);
+    std::vector<uint8_t> bandBuffer(PANEL_WIDTH / 4 * BAND_ROWS);
+    CalBand band(PANEL_WIDTH, PANEL_HEIGHT, bandBuffer.data(), BAND_ROWS);
+    band.setRotation(1);
+    stages.canvas = &band;
+    stages.pixels = 0;
+    unsigned badBands = 0;
+    for (uint16_t row = 0; row < PANEL_HEIGHT; row += BAND_ROWS) {
+        band.begin(row, &CAL_BACKGROUND);
+        int16_t x, y, w, h;
+        band.screenRect(x, y, w, h);
+        list.replay(band, x, y, w, h);
+        if (memcmp(band.buffer(), frameBuffer.data() + (size_t)row * (PANEL_WIDTH / 4), band.bytes()) != 0)
+            badBands++;
+    }
+    report("bands", &stages);
+    stages.canvas = &canvas;
+    stages.pixels = canvas.pixelWrites();
+
+    if (!writePng(canvas, output)) {
+        fprintf(stderr, "cannot write %s\n", output);
+        return 1;
+    }
+    report("png", &stages);
+    if (native && !writeFile(native, frameBuffer)) {
+        fprintf(stderr, "cannot write %s\n", native);
+        return 1;
+    }
+
+    printf("RENDER {\"stage\":\"total\",\"us\":%.1f,\"pixels\":%llu,\"date\":\"%s\",\"events\":%u,\"boxes\":%u,"
+           "\"digest\":\"%08x\",\"bands_match\":%s}\n",
+           stages.totalUs, (unsigned long long)stages.totalPixels, date, (unsigned)filter.events.size(),
+           (unsigned)boxes.size(), (unsigned)fnv1a(frameBuffer), badBands ? "false" : "true");
+    if (badBands) {
+        fprintf(stderr, "%u bands differ from the direct rendering: CAL_BACKGROUND is stale, "
+                        "regenerate it with --background\n", badBands);
+        return 3;
+    }
+    return 0;
+}